@@ -0,0 +1,32 @@
+#include "AliasTable.hpp"
+
+AliasTable::AliasTable(const std::vector<double>& weights) :
+    prob(weights.size()), alias(weights.size()) {
+    const uint n = weights.size();
+    for (double w : weights) sum += w;
+
+    // Scale weights so that the average column is 1
+    std::vector<uint> small, large;
+    small.reserve(n);
+    large.reserve(n);
+    for (uint i = 0; i < n; ++i) {
+        prob[i] = weights[i] * n / sum;
+        alias[i] = i;
+        (prob[i] < 1 ? small : large).push_back(i);
+    }
+
+    // Fill each underfull column with mass from an overfull one
+    while (!small.empty() && !large.empty()) {
+        const uint s = small.back(), l = large.back();
+        small.pop_back();
+        alias[s] = l;
+        prob[l] -= 1 - prob[s];
+        if (prob[l] < 1) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Leftovers are full up to rounding errors
+    for (uint i : small) prob[i] = 1;
+    for (uint i : large) prob[i] = 1;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef ALIASTABLE_H
+#define ALIASTABLE_H
+
+#include <vector>
+#include <sys/types.h>
+
+// Walker/Vose alias table: after an O(n) setup, draws an index with
+// probability proportional to its weight in O(1)
+class AliasTable {
+    public:
+        AliasTable() {}
+        AliasTable(const std::vector<double>& weights);
+
+        // Index for a uniform random number in [0,1)
+        inline uint sample(double r) const {
+            const double x = r * prob.size();
+            uint i = static_cast<uint>(x);
+            if (i >= prob.size()) i = prob.size() - 1;
+            return (x - i < prob[i]) ? i : alias[i];
+        }
+        inline size_t size() const { return prob.size(); }
+        inline double total() const { return sum; }
+        inline size_t byteSize() const {
+            return prob.capacity() * sizeof(double) +
+                alias.capacity() * sizeof(uint);
+        }
+
+    private:
+        std::vector<double> prob;   // probability of keeping the column
+        std::vector<uint> alias;    // index drawn otherwise
+        double sum = 0;
+};
+
+#endif
\ No newline at end of file
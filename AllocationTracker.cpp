@@ -0,0 +1,213 @@
+#include "AllocationTracker.hpp"
+
+#ifdef NICE_ALLOC_TRACK
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace {
+    // Counters are plain atomics in static tables, so that counting never
+    // allocates and works from the first allocation of the process
+    const uint maxStages = 64;
+    struct Counters {
+        std::atomic<uint64_t> allocations{0}, frees{0}, bytes{0};
+        std::atomic<int64_t> live{0}, peak{0};
+    };
+    Counters counters[maxStages];
+    const char* names[maxStages] = {""};
+    std::atomic<uint> stageCount{1};
+    std::mutex stagesMtx;
+    std::atomic<int64_t> live{0}, peak{0};
+    thread_local uint currentStage = 0;
+
+    const auto relaxed = std::memory_order_relaxed;
+
+    // Every block is preceded by its size and stage, so that frees count
+    // for the stage which allocated. The header takes the alignment of the
+    // block, and at least that of malloc.
+    struct Header {
+        uint64_t size;
+        uint32_t stage;
+    };
+    const size_t headerSize = 16;
+    static_assert(sizeof(Header) <= headerSize, "Header too large");
+
+    inline size_t headerFor(size_t alignment) {
+        return std::max(headerSize, alignment);
+    }
+    inline Header* headerOf(void* p) {
+        return reinterpret_cast<Header*>(static_cast<char*>(p) - headerSize);
+    }
+
+    uint stageIndex(const char* name) {
+        uint n = stageCount.load(std::memory_order_acquire);
+        for (uint i = 0; i < n; ++i) {
+            if (strcmp(names[i], name) == 0) return i;
+        }
+        std::lock_guard<std::mutex> lock(stagesMtx);
+        for (; n < stageCount.load(); ++n) {
+            if (strcmp(names[n], name) == 0) return n;
+        }
+        if (n == maxStages) return 0;
+        names[n] = name;
+        stageCount.store(n + 1, std::memory_order_release);
+        return n;
+    }
+
+    inline void raise(std::atomic<int64_t>& top, int64_t now) {
+        int64_t t = top.load(relaxed);
+        while (now > t && !top.compare_exchange_weak(t, now, relaxed)) {}
+    }
+
+    void* counted(void* block, size_t size, size_t header) {
+        void* p = static_cast<char*>(block) + header;
+        const uint stage = currentStage;
+        *headerOf(p) = {size, stage};
+        Counters& c = counters[stage];
+        c.allocations.fetch_add(1, relaxed);
+        c.bytes.fetch_add(size, relaxed);
+        raise(c.peak, c.live.fetch_add(size, relaxed) + int64_t(size));
+        raise(peak, live.fetch_add(size, relaxed) + int64_t(size));
+        return p;
+    }
+
+    void release(void* p, size_t alignment = 0) {
+        if (!p) return;
+        const Header h = *headerOf(p);
+        counters[currentStage].frees.fetch_add(1, relaxed);
+        counters[h.stage].live.fetch_sub(h.size, relaxed);
+        live.fetch_sub(h.size, relaxed);
+        free(static_cast<char*>(p) - headerFor(alignment));
+    }
+
+    // Standard behaviour on failure: call the new handler and retry
+    void* allocate(size_t size, size_t alignment = 0) {
+        const size_t header = headerFor(alignment);
+        while (true) {
+            void* block = nullptr;
+            if (alignment == 0) block = malloc(size + header);
+            else if (posix_memalign(&block, std::max(alignment,
+                sizeof(void*)), size + header) != 0) block = nullptr;
+            if (block) return counted(block, size, header);
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+
+void* operator new(size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); }
+    catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t a) noexcept {
+    release(p, static_cast<size_t>(a));
+}
+void operator delete[](void* p, std::align_val_t a) noexcept {
+    release(p, static_cast<size_t>(a));
+}
+void operator delete(void* p, size_t, std::align_val_t a) noexcept {
+    release(p, static_cast<size_t>(a));
+}
+void operator delete[](void* p, size_t, std::align_val_t a) noexcept {
+    release(p, static_cast<size_t>(a));
+}
+
+
+bool AllocationTracker::enabled() {
+    return true;
+}
+
+AllocationTracker::Count AllocationTracker::total() {
+    Count c;
+    const uint n = stageCount.load(std::memory_order_acquire);
+    for (uint i = 0; i < n; ++i) {
+        c.allocations += counters[i].allocations.load(relaxed);
+        c.frees += counters[i].frees.load(relaxed);
+        c.bytes += counters[i].bytes.load(relaxed);
+    }
+    c.live = live.load(relaxed);
+    c.peak = peak.load(relaxed);
+    return c;
+}
+
+AllocationTracker::Stages AllocationTracker::stages() {
+    Stages s;
+    const uint n = stageCount.load(std::memory_order_acquire);
+    s.reserve(n);
+    for (uint i = 0; i < n; ++i) {
+        Count c;
+        c.allocations = counters[i].allocations.load(relaxed);
+        c.frees = counters[i].frees.load(relaxed);
+        c.bytes = counters[i].bytes.load(relaxed);
+        c.live = counters[i].live.load(relaxed);
+        c.peak = counters[i].peak.load(relaxed);
+        s.push_back({names[i], c});
+    }
+    return s;
+}
+
+void AllocationTracker::resetPeak() {
+    peak.store(live.load(relaxed), relaxed);
+    const uint n = stageCount.load(std::memory_order_acquire);
+    for (uint i = 0; i < n; ++i)
+        counters[i].peak.store(counters[i].live.load(relaxed), relaxed);
+}
+
+AllocationTracker::Tag::Tag(const char* name) : previous(currentStage) {
+    currentStage = stageIndex(name);
+}
+
+AllocationTracker::Tag::~Tag() {
+    currentStage = previous;
+}
+
+#else
+bool AllocationTracker::enabled() {
+    return false;
+}
+
+AllocationTracker::Count AllocationTracker::total() {
+    return Count();
+}
+
+AllocationTracker::Stages AllocationTracker::stages() {
+    return Stages();
+}
+
+void AllocationTracker::resetPeak() {}
+
+AllocationTracker::Tag::Tag(const char*) : previous(0) {}
+
+AllocationTracker::Tag::~Tag() {}
+#endif
\ No newline at end of file
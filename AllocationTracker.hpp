@@ -0,0 +1,51 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Heap allocation counts, compiled in with NICE_ALLOC_TRACK (make ALLOC=1),
+// which replaces the global operator new and delete. Allocations are
+// counted for the whole process and for the stage they are made in: the
+// innermost ALLOC_SCOPE (or PROFILE_SCOPE) of the thread. Byte counts are
+// the requested sizes; live bytes count for the stage which allocated
+// them, wherever they are freed.
+#ifdef NICE_ALLOC_TRACK
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#define ALLOC_SCOPE(name) \
+    AllocationTracker::Tag ALLOC_CONCAT(allocScope, __LINE__)(name)
+#else
+#define ALLOC_SCOPE(name)
+#endif
+
+class AllocationTracker {
+    public:
+        struct Count {
+            uint64_t allocations = 0, frees = 0;
+            uint64_t bytes = 0;         // allocated
+            int64_t live = 0;           // bytes not yet freed
+            int64_t peak = 0;           // of live bytes, since resetPeak
+        };
+        // Stages seen so far, by name; allocations outside any stage are
+        // under ""
+        typedef std::vector<std::pair<std::string, Count>> Stages;
+
+        static bool enabled();
+        static Count total();
+        static Stages stages();
+        // Restarts the peak from the current live bytes
+        static void resetPeak();
+
+        // Allocations of this thread count for the stage until destruction
+        class Tag {
+            public:
+                Tag(const char* name);
+                ~Tag();
+            private:
+                const uint previous;
+        };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "AreaSampler.hpp"
+#include <algorithm>
+
+AreaSampler::AreaSampler(const Mesh& m) : mesh(m) {
+    std::vector<double> areas(mesh.faceNum());
+    for (uint i = 0; i < mesh.faceNum(); ++i) areas[i] = mesh.getArea(i);
+    table = AliasTable(areas);
+    cdf.resize(areas.size() + 1, 0);
+    for (uint i = 0; i < areas.size(); ++i) cdf[i+1] = cdf[i] + areas[i];
+}
+
+glm::dvec2 AreaSampler::sampleUV(RandPoint::Stream& rng) const {
+    const uint randomFace = table.sample(rng.uniform());
+    const double p = rng.uniform();
+    return inFace(randomFace, p, rng.uniform());
+}
+
+glm::dvec2 AreaSampler::warp(glm::dvec2 p) const {
+    // The face is found by inverting the cumulative area, and the position
+    // within its span is reused for the point in the face
+    const double x = p.x * cdf.back();
+    const uint face = std::min<size_t>(cdf.size() - 2,
+        std::upper_bound(cdf.begin() + 1, cdf.end(), x) - cdf.begin() - 1);
+    const double span = cdf[face+1] - cdf[face];
+    const double s = (span > 0) ? (x - cdf[face]) / span : .5;
+    return inFace(face, std::min(std::max(s, 0.), 1.), p.y);
+}
+
+glm::dvec2 AreaSampler::inFace(uint randomFace, double p, double q) const {
+    // Get face
+    glm::dvec2 v[3];
+    for (uint j=0; j<3; ++j) {
+        v[j].x = mesh.cAttrib(mesh.cFacei(randomFace,j), Mesh::Attribute::U);
+        v[j].y = mesh.cAttrib(mesh.cFacei(randomFace,j), Mesh::Attribute::V);
+    }
+    // Check if the triangle overlaps the border of the uv plane
+    // Very reasonable assumption: no triangle spans more than 
+    // half the plane in U or V direction
+    const double lmax = .25, rmin = .75;
+    // If there are any points on the far right...
+    if (v[0].x > rmin || v[1].x > rmin || v[2].x > rmin) {
+        // Check which points lie on the far left and "unwrap" them
+        for (uint k = 0; k < 3; ++k) {
+            if (v[k].x < lmax) v[k].x += 1;
+        }
+    }
+    // Same for the y
+    if (v[0].y > rmin || v[1].y > rmin || v[2].y > rmin) {
+        for (uint k = 0; k < 3; ++k) {
+            if (v[k].y < lmax) v[k].y += 1;
+        }
+    }
+    auto rnd = RandPoint::inTriangle(v[0], v[1], v[2], p, q);
+    // Wrap back the coordinates for triangles over the border
+    if (rnd.x > 1) rnd.x -= 1;
+    if (rnd.y > 1) rnd.y -= 1;
+    return rnd;
+}
\ No newline at end of file
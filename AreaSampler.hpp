@@ -0,0 +1,33 @@
+#ifndef AREASAMPLER_H
+#define AREASAMPLER_H
+
+#include "Mesh.hpp"
+#include "AliasTable.hpp"
+#include "UVSampler.hpp"
+
+// Uniform sampling of a mesh surface in parametric coordinates, following
+// its piecewise linear surface. Faces are drawn proportionally to their area
+// through an alias table, so each sample costs O(1) regardless of the face
+// count.
+class AreaSampler : public UVSampler {
+    public:
+        AreaSampler(const Mesh& m);
+
+        using UVSampler::sampleUV;
+        glm::dvec2 sampleUV(RandPoint::Stream& rng = RandPoint::current())
+            const override;
+        glm::dvec2 warp(glm::dvec2 p) const override;
+
+        inline size_t byteSize() const override {
+            return table.byteSize() + cdf.capacity() * sizeof(double);
+        }
+
+    private:
+        // Point of a face for two numbers in [0,1)
+        glm::dvec2 inFace(uint face, double p, double q) const;
+        const Mesh& mesh;
+        AliasTable table;
+        std::vector<double> cdf;    // cumulative face area, for warp
+};
+
+#endif
\ No newline at end of file
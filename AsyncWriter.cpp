@@ -0,0 +1,56 @@
+#include "AsyncWriter.hpp"
+#include <omp.h>
+
+AsyncWriter::AsyncWriter(uint threads, size_t memoryCap, uint ompThreads) :
+    cap(memoryCap), ompThreads(ompThreads) {
+    for (uint i = 0; i < threads; ++i) {
+        workers.emplace_back(&AsyncWriter::work, this);
+    }
+}
+
+AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (std::thread& w : workers) w.join();
+}
+
+void AsyncWriter::submit(std::function<void()> task, size_t bytes) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    // A task larger than the cap is still accepted once the queue is empty
+    taskDone.wait(lock, [&]{ return inFlight == 0 || inFlight + bytes <= cap; });
+    inFlight += bytes;
+    queue.push_back({task, bytes});
+    lock.unlock();
+    taskReady.notify_one();
+}
+
+void AsyncWriter::wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    taskDone.wait(lock, [&]{ return queue.empty() && running == 0; });
+}
+
+void AsyncWriter::work() {
+    if (ompThreads > 0) omp_set_num_threads(ompThreads);
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        taskReady.wait(lock, [&]{ return stopping || !queue.empty(); });
+        // Drain the queue before stopping
+        if (queue.empty()) return;
+        Task t = queue.front();
+        queue.pop_front();
+        ++running;
+        lock.unlock();
+        t.run();
+        lock.lock();
+        --running;
+        inFlight -= t.bytes;
+        taskDone.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/types.h>
+
+// Bounded queue of output tasks drained by background writer threads.
+// Each task declares how many bytes it keeps alive until it has run; submit
+// blocks while the bytes in flight would exceed the cap (backpressure).
+// With zero threads, tasks run synchronously inside submit. Writer threads
+// start with the OpenMP defaults of the process, not those of the thread
+// creating them, so parallel writes are limited to ompThreads (if not 0).
+class AsyncWriter {
+    public:
+        AsyncWriter(uint threads = 1, size_t memoryCap = 1 << 30,
+            uint ompThreads = 0);
+        ~AsyncWriter();
+
+        void submit(std::function<void()> task, size_t bytes);
+        void wait();    // until all submitted tasks have completed
+
+    private:
+        struct Task {
+            std::function<void()> run;
+            size_t bytes;
+        };
+        const size_t cap;
+        const uint ompThreads;  // of each writer thread
+        size_t inFlight = 0;    // bytes held by queued or running tasks
+        uint running = 0;
+        bool stopping = false;
+        std::deque<Task> queue;
+        std::vector<std::thread> workers;
+        std::mutex mtx;
+        std::condition_variable taskReady, taskDone;
+
+        void work();
+};
+
+#endif
\ No newline at end of file
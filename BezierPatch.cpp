@@ -1,75 +1,72 @@
 #include "BezierPatch.hpp"
+#include "MeshStream.hpp"
+#include "CompressedStream.hpp"
+#include "SurfaceSampling.hpp"
 
-void BezierPatch::bcPrepare() {
-    uint k = ((degree-1) * (degree-1) + degree-1) / 2;
-    bc = new uint[k];
-    for (uint i = 0; i < k; ++i) {
-        bc[i] = 0;
-    }
-}
-
-uint BezierPatch::binomial(int k, int n) const {
+uint BezierPatch::binomial(int k, int n) {
     if (k < 0 || k > n) throw std::domain_error("K must be between 0 and N.");
-    if (k == 0 || k == n) return 1;
-    const uint nn = n-2;
-    const uint ind = (nn*nn + nn)/2 + k-1;
-    if (bc[ind] == 0) bc[ind] = binomial(k-1, n-1) + binomial(k, n-1);
-    return bc[ind];
+    uint res = 1;
+    for (int i = 1; i <= k; ++i) res = res * (n - k + i) / i;
+    return res;
 }
 
 
-glm::dvec3 BezierPatch::sampleSurface(
-    double u, double v, uint derivU, uint derivV) const {
+glm::dvec3 BezierPatch::sampleSurface(const ControlGrid *const cg,
+    double u, double v, uint derivU, uint derivV) {
     glm::dvec3 p(0);
     for (uint i = 0; i <= degree; ++i) {
         for (int j = 0; j <= degree; ++j) {
             p += glm::dvec1(
                 bPoly(i, degree, u, derivU) * 
                 bPoly(j, degree, v, derivV)
-            ) * control->get(i, j);
+            ) * cg->get(i, j);
         }
     }
     return p;
 }
 
 
+void BezierPatch::evaluate(const ControlGrid *const cg, double u, double v,
+    double* att) {
+    const glm::dvec3 x = sampleSurface(cg, u, v);
+    att[X] = x[0];
+    att[Y] = x[1];
+    att[Z] = x[2];
+
+    // Compute normals analitically
+    const DifferentialQuantities dq = diffEvaluate(cg, u, v);
+
+    // Normals
+    att[NX] = dq.normal().x;
+    att[NY] = dq.normal().y;
+    att[NZ] = dq.normal().z;
+
+    // Parametric coordinates
+    att[U] = u;
+    att[V] = v;
+    
+    // Curvature
+    att[H] = dq.meanCurvature();
+    att[K] = dq.gaussianCurvature();
+}
+
+
 BezierPatch::BezierPatch(const ControlGrid *const cg, uint samples)
     : Mesh(true, true, true), control(cg) {
     name = "BezierPatch";
     const uint uvSamples = samples * samples;
     const double uvStep = 1.0 / static_cast<double>(samples-1);
     reserveSpace(uvSamples, uvSamples/2);
-    bcPrepare();
 
     // Compute points
     // Iterate on sample points (u,v)
+    double att[MeshStream::attributes];
     for (uint u = 0; u < samples; ++u) {
         for (uint v = 0; v < samples; ++v) {
-            const double uu = u * uvStep, vv = v * uvStep;
-            // Iterate on control points (i,j)
-            const glm::dvec3 x = sampleSurface(uu, vv);
-            const uint index = addVertex(x[0], x[1], x[2]);
-
-            // Compute normals analitically
-            const glm::dvec3 xu = sampleSurface(uu, vv, 1, 0);
-            const glm::dvec3 xv = sampleSurface(uu, vv, 0, 1);
-            const glm::dvec3 xuu = sampleSurface(uu, vv, 2, 0);
-            const glm::dvec3 xuv = sampleSurface(uu, vv, 1, 1);
-            const glm::dvec3 xvv = sampleSurface(uu, vv, 0, 2);
-            const DifferentialQuantities dq(xu, xv, xuu, xuv, xvv);
-
-            // Normals
-            attrib(index, Attribute::NX) = dq.normal().x;
-            attrib(index, Attribute::NY) = dq.normal().y;
-            attrib(index, Attribute::NZ) = dq.normal().z;
-
-            // Parametric coordinates
-            attrib(index, Attribute::U) = uu;
-            attrib(index, Attribute::V) = vv;
-            
-            // Curvature
-            attrib(index, Attribute::H) = dq.meanCurvature();
-            attrib(index, Attribute::K) = dq.gaussianCurvature();
+            const uint index = addVertex();
+            evaluate(cg, u * uvStep, v * uvStep, att);
+            for (uint k = 0; k < MeshStream::attributes; ++k)
+                attrib(index, k) = att[k];
 
             if (u < samples-1 && v < samples-1) {
                 const uint id = samples * u + v;
@@ -82,13 +79,38 @@ BezierPatch::BezierPatch(const ControlGrid *const cg, uint samples)
 }
 
 
+void BezierPatch::stream(std::string path, std::string name,
+    const ControlGrid *const cg, uint samples) {
+    const double uvStep = 1.0 / static_cast<double>(samples-1);
+    MeshStream out(path, name, samples * samples,
+        2 * (samples-1) * (samples-1));
+
+    // Vertices, one row at a time
+    double att[MeshStream::attributes];
+    for (uint u = 0; u < samples; ++u) {
+        for (uint v = 0; v < samples; ++v) {
+            evaluate(cg, u * uvStep, v * uvStep, att);
+            out.vertex(att);
+        }
+    }
+    // Faces follow from the grid indices
+    for (uint u = 0; u < samples-1; ++u) {
+        for (uint v = 0; v < samples-1; ++v) {
+            const uint id = samples * u + v;
+            out.face(id, id+1, id+samples);
+            out.face(id+1, id+samples+1, id+samples);
+        }
+    }
+    out.close();
+}
+
+
 BezierPatch::BezierPatch(const ControlGrid *const cg, const PlaneSampling& smp)
     : Mesh(true, true, true), control(cg) {
     name = "BezierPatch";
     const uint NV = smp.vertNum();
     const uint NF = smp.faceNum();
     reserveSpace(NV, NF);
-    bcPrepare();
 
     // Compute vertices
     for (uint i = 0; i < NV; ++i) {
@@ -120,22 +142,22 @@ BezierPatch::BezierPatch(const ControlGrid *const cg, const PlaneSampling& smp)
 }
 
 BezierPatch::BezierPatch(const ControlGrid *const cg,
-    uint samples, double aniso) :
+    uint samples, double aniso, const SurfaceSampling::Options& options) :
     /*
-    This monstrosity creates a simple "base" uniform mesh, samples it,
-    triangulates it, and finally calls the PlaneSampling constructor.
-    Anisotropy is currently ignored.
+    Samples the parameter domain following a metric aligned with the
+    principal directions, triangulates it, and calls the PlaneSampling
+    constructor.
     */
     BezierPatch(cg, 
-        PlaneSampling(
-            BezierPatch(cg,16).uniformSampling(
-                samples, true, 4*std::floor(sqrt(samples)))
+        SurfaceSampling::plane(
+            SurfaceSampling::metric([=](double u, double v) {
+                return diffEvaluate(cg, u, v);
+            }, aniso, options), samples, options
         )
     ) {}
 
 BezierPatch::~BezierPatch() {
     delete control;
-    delete[] bc;
 }
 
 
@@ -195,11 +217,16 @@ BezierPatch::ControlGrid::ControlGrid(double maxNorm, double bb, double ib) {
 }
 
 DifferentialQuantities BezierPatch::diffEvaluate(double u, double v) const {
-    const glm::dvec3 xu = sampleSurface(u, v, 1, 0);
-    const glm::dvec3 xv = sampleSurface(u, v, 0, 1);
-    const glm::dvec3 xuu = sampleSurface(u, v, 2, 0);
-    const glm::dvec3 xuv = sampleSurface(u, v, 1, 1);
-    const glm::dvec3 xvv = sampleSurface(u, v, 0, 2);
+    return diffEvaluate(control, u, v);
+}
+
+DifferentialQuantities BezierPatch::diffEvaluate(const ControlGrid *const cg,
+    double u, double v) {
+    const glm::dvec3 xu = sampleSurface(cg, u, v, 1, 0);
+    const glm::dvec3 xv = sampleSurface(cg, u, v, 0, 1);
+    const glm::dvec3 xuu = sampleSurface(cg, u, v, 2, 0);
+    const glm::dvec3 xuv = sampleSurface(cg, u, v, 1, 1);
+    const glm::dvec3 xvv = sampleSurface(cg, u, v, 0, 2);
     return DifferentialQuantities(xu, xv, xuu, xuv, xvv);
 }
 
@@ -207,7 +234,7 @@ DifferentialQuantities BezierPatch::diffEvaluate(double u, double v) const {
 void BezierPatch::ControlGrid::writeCoordinate(
     std::string path, int coordinate) {
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw Mesh::FileOpenException();
 
     // Write verts
@@ -220,4 +247,5 @@ void BezierPatch::ControlGrid::writeCoordinate(
 
     // Close file
     file.close();
+    if (!file) throw Mesh::FileWriteException();
 }
\ No newline at end of file
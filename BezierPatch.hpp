@@ -5,6 +5,7 @@
 #include "Constants.hpp"
 #include "RandPoint.hpp"
 #include "PlaneSampling.hpp"
+#include "SurfaceSampling.hpp"
 #include <glm/glm.hpp>
 
 class BezierPatch : public Mesh {
@@ -27,24 +28,32 @@ class BezierPatch : public Mesh {
         BezierPatch(
             const ControlGrid *const cg,
             uint samples,
-            double anisotropy
+            double anisotropy,
+            const SurfaceSampling::Options& options =
+                SurfaceSampling::Options()
         );
 
         ~BezierPatch();
 
         DifferentialQuantities diffEvaluate(double u, double v) const override;
+
+        // Write a regularly sampled patch directly to a PLY file, row by row
+        static void stream(
+            std::string path,
+            std::string name,
+            const ControlGrid *const cg,
+            uint samples
+        );
             
 
     private:
         const ControlGrid *const control;
         // Binomial coefficients
-        uint *bc;
-        uint binomial(int k, int n) const;
-        void bcPrepare();
+        static uint binomial(int k, int n);
 
         // Bernstein polynomials with derivatives
-        inline double bPoly(int i, int n, double x,
-            uint derivative = 0) const {
+        static inline double bPoly(int i, int n, double x,
+            uint derivative = 0) {
             if (derivative == 0) {
                 if (i < 0 || i > n) return 0;
                 return binomial(i, n) * pow(x, i) * pow(1-x, n-i);
@@ -56,8 +65,17 @@ class BezierPatch : public Mesh {
         }
 
         // Computations
-        glm::dvec3 sampleSurface(double u, double v,
-            uint derivU = 0, uint derivV = 0) const;
+        inline glm::dvec3 sampleSurface(double u, double v,
+            uint derivU = 0, uint derivV = 0) const {
+            return sampleSurface(control, u, v, derivU, derivV);
+        }
+        static glm::dvec3 sampleSurface(const ControlGrid *const cg,
+            double u, double v, uint derivU = 0, uint derivV = 0);
+        static DifferentialQuantities diffEvaluate(const ControlGrid *const cg,
+            double u, double v);
+        // All vertex attributes at (u,v), in storage order
+        static void evaluate(const ControlGrid *const cg, double u, double v,
+            double* att);
 };
 
 
@@ -1,4 +1,6 @@
 #include "Catenoid.hpp"
+#include "MeshStream.hpp"
+#include "SurfaceSampling.hpp"
 
 Catenoid::Catenoid(
         uint samples,   // samples in toroidal direction
@@ -12,11 +14,9 @@ Catenoid::Catenoid(
     // Sampling in rotational direction (uniform)
     const uint uSamples = samples;
     const double uStep = 1.0 / static_cast<double>(uSamples);
-    const double halfHeight = height / 2;
 
     // Pre-computation for sampling in vertical direction
-    const double tmp = TWOPI * (quad ? 1 : SQRT3_2) * uStep * rInner;
-    const uint vSamples = std::ceil(height / tmp);
+    const uint vSamples = axialSamples(uSamples, rInner, height, quad);
     const double vStep = 1.0 / static_cast<double>(vSamples-1);
     // rescale to [0, 1]
     const uint uvSamples = uSamples * vSamples;
@@ -34,18 +34,14 @@ Catenoid::Catenoid(
             double vv = v * vStep;
             if (uu < 0) uu += 1.;
             assert(uu >= 0 && vv >= 0 && uu <= 1 && vv <= 1);
-            const uint index = placeVertex(uu, vv);
+            placeVertex(uu, vv);
             
             // Add faces
             if (v != vSamples-1) {    // Open at the ends
-                const uint us = (u+uSamples-off)%uSamples;
-                uint a = index;
-                uint b = (u+1)%uSamples+v*uSamples;
-                uint c = ((u+1-off)%uSamples+(v+1)*uSamples)%uvSamples;
-                uint d = ((us+uSamples)%uSamples+(v+1)*uSamples)%uvSamples;
-
-                addFace(a, b, c);
-                addFace(a, c, d);
+                uint f[6];
+                cellFaces(u, v, uSamples, vSamples, quad, f);
+                addFace(f[0], f[1], f[2]);
+                addFace(f[3], f[4], f[5]);
             }
         }
     }
@@ -53,6 +49,65 @@ Catenoid::Catenoid(
 }
 
 
+void Catenoid::stream(std::string path, std::string name, uint samples,
+    double rOuter, double rInner, bool quad) {
+    assert(rOuter > rInner);
+    // Same sampling as the regular constructor
+    const double height = 2 * rInner * acosh(rOuter / rInner);
+    const uint uSamples = samples;
+    const double uStep = 1.0 / static_cast<double>(uSamples);
+    const uint vSamples = axialSamples(uSamples, rInner, height, quad);
+    const double vStep = 1.0 / static_cast<double>(vSamples-1);
+
+    MeshStream out(path, name, uSamples * vSamples,
+        2 * uSamples * (vSamples-1));
+
+    // Vertices, one row at a time
+    double att[MeshStream::attributes];
+    for (uint v = 0; v < vSamples; ++v) {
+        for (uint u = 0; u < uSamples; ++u) {
+            uint off = quad ? 0 : (v%2);
+            double uu = (u - off*.5) * uStep;
+            if (uu < 0) uu += 1.;
+            evaluate(rInner, height, uu, v * vStep, att);
+            out.vertex(att);
+        }
+    }
+    // Faces follow from the grid indices
+    for (uint v = 0; v < vSamples-1; ++v) {
+        for (uint u = 0; u < uSamples; ++u) {
+            uint f[6];
+            cellFaces(u, v, uSamples, vSamples, quad, f);
+            out.face(f[0], f[1], f[2]);
+            out.face(f[3], f[4], f[5]);
+        }
+    }
+    out.close();
+}
+
+
+uint Catenoid::axialSamples(uint uSamples, double rInner, double height,
+    bool quad) {
+    const double uStep = 1.0 / static_cast<double>(uSamples);
+    const double tmp = TWOPI * (quad ? 1 : SQRT3_2) * uStep * rInner;
+    return std::ceil(height / tmp);
+}
+
+
+void Catenoid::cellFaces(uint u, uint v, uint uSamples, uint vSamples,
+    bool quad, uint* f) {
+    const uint uvSamples = uSamples * vSamples;
+    const uint off = quad ? 0 : (v%2);
+    const uint us = (u+uSamples-off)%uSamples;
+    uint a = u+v*uSamples;
+    uint b = (u+1)%uSamples+v*uSamples;
+    uint c = ((u+1-off)%uSamples+(v+1)*uSamples)%uvSamples;
+    uint d = ((us+uSamples)%uSamples+(v+1)*uSamples)%uvSamples;
+    f[0] = a; f[1] = b; f[2] = c;
+    f[3] = a; f[4] = c; f[5] = d;
+}
+
+
 Catenoid::Catenoid(
         std::string path,
         double rOuter,
@@ -87,33 +142,17 @@ Catenoid::Catenoid(const PlaneSampling& plane, double rOuter, double rInner) :
     const uint pv = plane.vertNum(), pf = plane.faceNum();
     reserveSpace(pv, pf);
 
-    // Place vertices
-    std::vector<unsigned long> boundary;   // boundary vertices on plane
-    std::vector<unsigned long> newId;   // vertex index on the surface
-    newId.reserve(pv);
-    
-    for (unsigned long int i = 0; i < pv; ++i) {
-        const double ui = plane.cAttrib(i, 0), vi = plane.cAttrib(i, 1);
-        const double mui = ui - floor(ui);
-        // Boundary vertex duplicate checking
-        if (mui == 0.) {
-            bool duplicate = false;
-            for (unsigned long j : boundary) {
-                const double uj = plane.cAttrib(j, 0), vj = plane.cAttrib(j, 1);
-                if (vi == vj) {
-                    duplicate = true;
-                    newId.push_back(newId.at(j));
-                    break;
-                }
-            }
-            if (!duplicate) {
-                boundary.push_back(i);
-                newId.push_back(placeVertex(ui, vi));
-            }
-        }
-        else {
-            newId.push_back(placeVertex(ui, vi));
-        }
+    // Place vertices, once for each group of points which coincide
+    // around the seams (periodic in the rotational direction); only
+    // planes triangulated on the square have such groups
+    const double period[2] = {1, 0};
+    const std::vector<uint> rep = weldMap(plane.verts.data(), pv, 2, 2,
+        WELD_TOLERANCE, period);
+    std::vector<uint> newId(pv);
+    for (uint i = 0; i < pv; ++i) {
+        newId[i] = (rep[i] == i) ?
+            placeVertex(plane.cAttrib(i, 0), plane.cAttrib(i, 1)) :
+            newId[rep[i]];
     }
 
     // Write faces w/ substitutions
@@ -127,43 +166,53 @@ Catenoid::Catenoid(const PlaneSampling& plane, double rOuter, double rInner) :
     computeNormals(true);
 }
 
-Catenoid::Catenoid(uint samples, double rOuter, double rInner, double aniso) :
+Catenoid::Catenoid(uint samples, double rOuter, double rInner, double aniso,
+    const SurfaceSampling::Options& options) :
     /*
-    This monstrosity creates a simple "base" uniform mesh, samples it,
-    triangulates it, and finally calls the PlaneSampling constructor.
-    Anisotropy is currently ignored.
+    Samples the parameter domain following a metric aligned with the
+    principal directions, triangulates it with the seams closed, and calls
+    the PlaneSampling constructor.
     */
-    Catenoid(PlaneSampling(
-        Catenoid(16, rOuter, rInner).uniformSampling(
-            samples, true, 4 * std::floor(sqrt(samples)))
-        ), rOuter, rInner
+    Catenoid(SurfaceSampling::plane(
+        SurfaceSampling::metric([=](double u, double v) {
+            const double height = 2 * rInner * acosh(rOuter / rInner);
+            return diffEvaluate(rInner, height, u, v);
+        }, aniso, options), samples, options,
+        PlaneSampling::CYLINDER), rOuter, rInner
     ) {}
 
 
 void Catenoid::replaceVertex(uint index, double u, double v) {
+    double att[MeshStream::attributes];
+    evaluate(rInner, height, u, v, att);
+    for (uint k = 0; k < MeshStream::attributes; ++k) attrib(index, k) = att[k];
+}
+
+void Catenoid::evaluate(double rInner, double height, double u, double v,
+    double* att) {
     const double vs = (v-.5)*height;
     const double sinu = sin(TWOPI * u);
     const double cosu = cos(TWOPI * u);
     const double sinhv = sinh(vs / rInner);
     const double coshv = cosh(vs / rInner);
 
-    attrib(index, Attribute::X) = rInner * coshv * cosu;
-    attrib(index, Attribute::Y) = rInner * coshv * sinu;
-    attrib(index, Attribute::Z) = vs;
+    att[X] = rInner * coshv * cosu;
+    att[Y] = rInner * coshv * sinu;
+    att[Z] = vs;
 
     // Normals
     const double nrmFac = 1/coshv;
-    attrib(index, Attribute::NX) = cosu * nrmFac;
-    attrib(index, Attribute::NY) = sinu * nrmFac;
-    attrib(index, Attribute::NZ) = -sinhv * nrmFac;
+    att[NX] = cosu * nrmFac;
+    att[NY] = sinu * nrmFac;
+    att[NZ] = -sinhv * nrmFac;
 
     // Write parametric coordinates
-    attrib(index, Attribute::U) = u;
-    attrib(index, Attribute::V) = v;
+    att[U] = u;
+    att[V] = v;
 
     // Curvature
-    attrib(index, Attribute::H) = 0;
-    attrib(index, Attribute::K) = -pow(rInner, -2) * pow(coshv, -4);
+    att[H] = 0;
+    att[K] = -pow(rInner, -2) * pow(coshv, -4);
 }
 
 uint Catenoid::placeVertex(double u, double v) {
@@ -174,6 +223,11 @@ uint Catenoid::placeVertex(double u, double v) {
 
 
 DifferentialQuantities Catenoid::diffEvaluate(double u, double v) const {
+    return diffEvaluate(rInner, height, u, v);
+}
+
+DifferentialQuantities Catenoid::diffEvaluate(double rInner, double height,
+    double u, double v) {
     const double vs = (v-.5)*height;
     const double sinu = sin(TWOPI * u);
     const double cosu = cos(TWOPI * u);
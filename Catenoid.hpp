@@ -5,6 +5,7 @@
 #include "Constants.hpp"
 #include "PlaneSampling.hpp"
 #include "DifferentialQuantities.hpp"
+#include "SurfaceSampling.hpp"
 
 class Catenoid : public Mesh {
     public:
@@ -28,11 +29,34 @@ class Catenoid : public Mesh {
             uint samples,
             double rOuter,
             double rInner,
-            double anisotropy
+            double anisotropy,
+            const SurfaceSampling::Options& options =
+                SurfaceSampling::Options()
         );
         DifferentialQuantities diffEvaluate(double u, double v) const override;
 
+        // Write a regular catenoid directly to a PLY file, row by row
+        static void stream(
+            std::string path,
+            std::string name,
+            uint samples,
+            double rOuter,
+            double rInner,
+            bool quad = false
+        );
+
     private:
+        // Number of rows along the axis
+        static uint axialSamples(uint uSamples, double rInner, double height,
+            bool quad);
+        // Indices of the two faces of the grid cell at (u,v)
+        static void cellFaces(uint u, uint v, uint uSamples, uint vSamples,
+            bool quad, uint* f);
+        // All vertex attributes at (u,v), in storage order
+        static void evaluate(double rInner, double height, double u, double v,
+            double* att);
+        static DifferentialQuantities diffEvaluate(double rInner,
+            double height, double u, double v);
         const double rInner, rOuter, height;
         uint placeVertex(double u, double v);
         void replaceVertex(uint index, double u, double v);
@@ -0,0 +1,47 @@
+#ifndef CHUNKEDOUTPUT_H
+#define CHUNKEDOUTPUT_H
+
+#include <ostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+// Parallel formatting of text output. The rows of a file are split into
+// chunks, each chunk is formatted into its own buffer by a worker thread,
+// and the buffers are written in order, so the result is byte-identical to
+// writing the rows one after the other.
+namespace ChunkedOutput {
+    const size_t chunkRows = 1 << 14;
+
+    // Calls row(stream, i) for every i in [0, count)
+    template <typename RowFunction>
+    void write(std::ostream& out, size_t count, RowFunction row) {
+        const size_t chunks = (count + chunkRows - 1) / chunkRows;
+        // Small outputs are formatted directly
+        if (chunks <= 1 || omp_get_max_threads() == 1 || omp_in_parallel()) {
+            for (size_t i = 0; i < count; ++i) row(out, i);
+            return;
+        }
+        // Format a bounded number of chunks per round to cap memory use
+        const size_t round = 2 * omp_get_max_threads();
+        std::vector<std::stringstream> buffers(round);
+        for (size_t first = 0; first < chunks; first += round) {
+            const size_t last = std::min(chunks, first + round);
+            #pragma omp parallel for schedule(dynamic)
+            for (size_t c = first; c < last; ++c) {
+                std::stringstream& buf = buffers[c - first];
+                buf.str("");
+                buf.copyfmt(out);
+                const size_t end = std::min(count, (c+1) * chunkRows);
+                for (size_t i = c * chunkRows; i < end; ++i) row(buf, i);
+            }
+            for (size_t c = first; c < last; ++c) {
+                std::stringstream& buf = buffers[c - first];
+                if (buf.tellp() > 0) out << buf.rdbuf();
+            }
+        }
+    }
+}
+
+#endif
\ No newline at end of file
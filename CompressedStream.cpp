@@ -0,0 +1,214 @@
+#include "CompressedStream.hpp"
+#include <omp.h>
+
+// Compressed output
+
+CompressedBuf::CompressedBuf(std::streambuf* sink, Codec codec) :
+    sink(sink), codec(codec), current(blockSize) {
+    setp(current.data(), current.data() + current.size());
+}
+
+CompressedBuf::int_type CompressedBuf::overflow(int_type c) {
+    // Current block is full: queue it and start a new one
+    pending.emplace_back(current.begin(), current.end());
+    if (pending.size() >= static_cast<size_t>(omp_get_max_threads())) {
+        if (!compressPending()) return traits_type::eof();
+    }
+    setp(current.data(), current.data() + current.size());
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int CompressedBuf::sync() {
+    // Partial blocks are kept until finish, to avoid tiny members on flush
+    return (compressPending() && sink->pubsync() == 0) ? 0 : -1;
+}
+
+bool CompressedBuf::finish() {
+    if (pptr() > pbase()) pending.emplace_back(pbase(), pptr());
+    setp(current.data(), current.data() + current.size());
+    return compressPending();
+}
+
+bool CompressedBuf::compressPending() {
+    std::vector<std::vector<char>> out(pending.size());
+    bool compressed = true;
+    #pragma omp parallel for schedule(dynamic) reduction(&&:compressed)
+    for (size_t i = 0; i < pending.size(); ++i) {
+        compressed = compress(pending[i], codec, out[i]) && compressed;
+    }
+    pending.clear();
+    if (!compressed) failed = true;
+    // Write in order; nothing is written after a lost block
+    for (const std::vector<char>& block : out) {
+        if (failed) break;
+        const std::streamsize n = block.size();
+        if (sink->sputn(block.data(), n) != n) failed = true;
+    }
+    return !failed;
+}
+
+bool CompressedBuf::compress(const std::vector<char>& in, Codec codec,
+    std::vector<char>& out) {
+    if (codec == GZIP) {
+        z_stream zs = {};
+        // windowBits 15 + 16 writes a gzip header and trailer
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK) return false;
+        out.resize(deflateBound(&zs, in.size()) + 32);
+        zs.next_in = (Bytef*) in.data();
+        zs.avail_in = in.size();
+        zs.next_out = (Bytef*) out.data();
+        zs.avail_out = out.size();
+        const int status = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return status == Z_STREAM_END;
+    }
+#ifdef NICE_ZSTD
+    out.resize(ZSTD_compressBound(in.size()));
+    const size_t n = ZSTD_compress(out.data(), out.size(),
+        in.data(), in.size(), ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(n)) return false;
+    out.resize(n);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// Decompressed input
+
+GzipInBuf::GzipInBuf(std::string path) : buffer(CompressedBuf::blockSize) {
+    gz = gzopen(path.c_str(), "rb");
+    if (gz) gzbuffer(gz, CompressedBuf::blockSize);
+}
+
+GzipInBuf::~GzipInBuf() {
+    if (gz) gzclose(gz);
+}
+
+GzipInBuf::int_type GzipInBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    const int n = gzread(gz, buffer.data(), buffer.size());
+    if (n <= 0) return traits_type::eof();
+    setg(buffer.data(), buffer.data(), buffer.data() + n);
+    return traits_type::to_int_type(*gptr());
+}
+
+#ifdef NICE_ZSTD
+ZstdInBuf::ZstdInBuf(std::streambuf* source) : source(source),
+    inBuffer(ZSTD_DStreamInSize()), outBuffer(ZSTD_DStreamOutSize()) {
+    stream = ZSTD_createDStream();
+    ZSTD_initDStream(stream);
+    in = {inBuffer.data(), 0, 0};
+}
+
+ZstdInBuf::~ZstdInBuf() {
+    ZSTD_freeDStream(stream);
+}
+
+ZstdInBuf::int_type ZstdInBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    ZSTD_outBuffer out = {outBuffer.data(), outBuffer.size(), 0};
+    while (out.pos == 0) {
+        // Refill input when consumed
+        if (in.pos == in.size) {
+            in.size = source->sgetn(inBuffer.data(), inBuffer.size());
+            in.pos = 0;
+            if (in.size == 0) return traits_type::eof();
+        }
+        if (ZSTD_isError(ZSTD_decompressStream(stream, &out, &in)))
+            return traits_type::eof();
+    }
+    setg(outBuffer.data(), outBuffer.data(), outBuffer.data() + out.pos);
+    return traits_type::to_int_type(*gptr());
+}
+#endif
+
+
+// Files
+
+OutFile::OutFile(std::string path) : std::ostream(nullptr),
+    buffer(CompressedBuf::blockSize) {
+    file.pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios::out | std::ios::binary);
+    auto ends = [&](std::string ext) {
+        return path.size() >= ext.size() &&
+            path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    if (ends(".gz")) compressed = new CompressedBuf(&file, CompressedBuf::GZIP);
+#ifdef NICE_ZSTD
+    else if (ends(".zst"))
+        compressed = new CompressedBuf(&file, CompressedBuf::ZSTD);
+#endif
+    rdbuf(compressed ? static_cast<std::streambuf*>(compressed) : &file);
+    if (!file.is_open()) setstate(std::ios::failbit);
+}
+
+OutFile::~OutFile() {
+    close();
+}
+
+void OutFile::close() {
+    bool ok = true;
+    if (compressed) {
+        ok = compressed->finish();
+        // rdbuf clears the state, which keeps earlier write errors
+        const std::ios::iostate state = rdstate();
+        rdbuf(&file);
+        setstate(state);
+        delete compressed;
+        compressed = nullptr;
+    }
+    if (file.is_open() && !file.close()) ok = false;
+    if (!ok) setstate(std::ios::badbit);
+}
+
+std::string OutFile::extension(std::string codec) {
+    if (codec == "gzip") return ".gz";
+#ifdef NICE_ZSTD
+    if (codec == "zstd") return ".zst";
+#endif
+    if (codec == "none" || codec == "") return "";
+    throw UnsupportedCodecException();
+}
+
+InFile::InFile(std::string path) : std::istream(nullptr) {
+    if (!file.open(path, std::ios::in | std::ios::binary)) return;
+    open = true;
+    // Detect compression from the magic number
+    unsigned char magic[4] = {0, 0, 0, 0};
+    file.sgetn(reinterpret_cast<char*>(magic), 4);
+    file.pubseekpos(0);
+    if (magic[0] == 0x1f && magic[1] == 0x8b) {
+        file.close();
+        GzipInBuf* gz = new GzipInBuf(path);
+        open = gz->is_open();
+        decompressed = gz;
+    }
+#ifdef NICE_ZSTD
+    else if (magic[0] == 0x28 && magic[1] == 0xb5 &&
+        magic[2] == 0x2f && magic[3] == 0xfd) {
+        decompressed = new ZstdInBuf(&file);
+    }
+#endif
+    rdbuf(decompressed ? decompressed : &file);
+    if (!open) setstate(std::ios::failbit);
+}
+
+InFile::~InFile() {
+    close();
+}
+
+void InFile::close() {
+    rdbuf(&file);
+    delete decompressed;
+    decompressed = nullptr;
+    if (file.is_open()) file.close();
+    open = false;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef COMPRESSEDSTREAM_H
+#define COMPRESSEDSTREAM_H
+
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#ifdef NICE_ZSTD
+#include <zstd.h>
+#endif
+
+// Output buffer that compresses data in independent blocks (pigz style).
+// Each block becomes a complete gzip member or zstd frame, so blocks are
+// compressed in parallel and the concatenation is still a valid file.
+class CompressedBuf : public std::streambuf {
+    public:
+        enum Codec { GZIP, ZSTD };
+        static const size_t blockSize = 1 << 20;
+
+        CompressedBuf(std::streambuf* sink, Codec codec);
+        // Compresses and writes everything buffered so far; false if this
+        // or any earlier block failed
+        bool finish();
+
+    protected:
+        int_type overflow(int_type c) override;
+        int sync() override;
+
+    private:
+        std::streambuf* const sink;
+        const Codec codec;
+        std::vector<char> current;              // block being filled
+        std::vector<std::vector<char>> pending; // full blocks to compress
+        bool failed = false;    // a block was lost, so the file is corrupt
+
+        bool compressPending();
+        static bool compress(const std::vector<char>& in, Codec codec,
+            std::vector<char>& out);
+};
+
+// Input buffer decompressing a gzip file (any number of members)
+class GzipInBuf : public std::streambuf {
+    public:
+        GzipInBuf(std::string path);
+        ~GzipInBuf();
+        bool is_open() const { return gz != nullptr; }
+
+    protected:
+        int_type underflow() override;
+
+    private:
+        gzFile gz;
+        std::vector<char> buffer;
+};
+
+#ifdef NICE_ZSTD
+// Input buffer decompressing a zstd file (any number of frames)
+class ZstdInBuf : public std::streambuf {
+    public:
+        ZstdInBuf(std::streambuf* source);
+        ~ZstdInBuf();
+
+    protected:
+        int_type underflow() override;
+
+    private:
+        std::streambuf* const source;
+        ZSTD_DStream* stream;
+        std::vector<char> inBuffer, outBuffer;
+        ZSTD_inBuffer in;
+};
+#endif
+
+// Output file, compressed according to the extension (.gz, .zst)
+class OutFile : public std::ostream {
+    public:
+        OutFile(std::string path);
+        ~OutFile();
+        bool is_open() const { return file.is_open(); }
+        void close();
+
+        // Extension selecting the given codec ("none", "gzip", "zstd")
+        static std::string extension(std::string codec);
+        class UnsupportedCodecException;
+
+    private:
+        std::vector<char> buffer;
+        std::filebuf file;
+        CompressedBuf* compressed = nullptr;
+};
+
+// Input file, decompressed according to its content (gzip, zstd, plain)
+class InFile : public std::istream {
+    public:
+        InFile(std::string path);
+        ~InFile();
+        bool is_open() const { return open; }
+        void close();
+
+    private:
+        bool open = false;
+        std::filebuf file;
+        std::streambuf* decompressed = nullptr;
+};
+
+class OutFile::UnsupportedCodecException : public std::exception {
+    public: const char* what() { return "Compression codec not available"; }
+};
+
+#endif
\ No newline at end of file
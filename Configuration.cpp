@@ -1,88 +1,540 @@
 #include "Configuration.hpp"
+#include "CompressedStream.hpp"
+#include "RandPoint.hpp"
+#include <algorithm>
+#include <cmath>
+#include <set>
 
-void ConfigManager::defaultValues() {
-    auto& c = configuration;
-
-    c["shape"] = "torus";
-    c["name"] = "mesh";
-
-    c["interactive"] = "true";
-    c["repeat"] = "1";
-    c["inputPlane"] = "";
-    c["inputShape"] = "";
-    c["outFolder"] = "./";
-    c["savePLY"] = "false";
-    c["saveOBJ"] = "false";
-    c["saveOFF"] = "false";
-    c["exportUV"] = "false";
-    c["exportControlGrid"] = "false";
-
-    c["anisotropy"] = "";
-    c["samples"] = "64";
-    c["radius"] = "1";
-    c["innerRadius"] = "1";
-    c["outerRadius"] = "2";
-    c["centered"] = "false";
-    c["subdivision"] = "3";
-    c["elementType"] = "triangle";
-
-    c["noise"] = "0";
-    c["noiseType"] = "3d";
-
-    c["seed"] = "";
-    c["borderVariance"] = "1";
-    c["innerVariance"] = "1";
-
-    c["scalarField"] = "false";
-    c["scalarHeader"] = "false";
-    c["scalarFrequency"] = "1";
-    c["scalarAmplitude"] = "1";
-    c["scalarLaplacian"] = "false";
-    c["scalarGradient"] = "false";
-    c["scalarFaceGradient"] = "false";
-    c["scalarHessian"] = "false";
+namespace {
+    std::string lower(std::string s) {
+        for (char& c : s) c = tolower(c);
+        return s;
+    }
+
+    std::string trim(const std::string& s) {
+        const size_t a = s.find_first_not_of(" \t\r");
+        if (a == std::string::npos) return "";
+        return s.substr(a, s.find_last_not_of(" \t\r") - a + 1);
+    }
+
+    std::vector<std::string> split(const std::string& s, char sep) {
+        std::vector<std::string> items;
+        size_t a = 0;
+        for (size_t b; (b = s.find(sep, a)) != std::string::npos; a = b + 1)
+            items.push_back(trim(s.substr(a, b - a)));
+        items.push_back(trim(s.substr(a)));
+        return items;
+    }
+
+    bool number(const std::string& t, double& v) {
+        size_t end = 0;
+        try { v = std::stod(t, &end); }
+        catch (std::exception& e) { return false; }
+        return end == t.size() && std::isfinite(v);
+    }
+
+    // Values generated by sweeps and distributions
+    std::string format(double v, bool integer) {
+        if (integer) return std::to_string(llround(v));
+        char text[32];
+        snprintf(text, sizeof(text), "%.15g", v);
+        return text;
+    }
+
+    // Keys that apply to the whole configuration, so they cannot vary
+    const std::set<std::string> fixedKeys = {
+        "name", "repeat", "seed", "interactive", "stream", "outFolder",
+        "compression", "writerThreads", "writerMemory", "triangulationCache",
+        "triangulationCacheMemory", "metric"
+    };
+    // Keys that can be swept over ranges or drawn from distributions
+    const std::set<std::string> integerKeys = {"samples", "subdivision"};
+    const std::set<std::string> realKeys = {
+        "anisotropy", "radius", "innerRadius", "outerRadius", "noise",
+        "borderVariance", "innerVariance", "scalarFrequency", "scalarAmplitude"
+    };
+    const size_t maxAxis = 1 << 20;     // values in a range
+    // Keys that do not change the outputs of a given job
+    const std::set<std::string> runKeys = {
+        "repeat", "interactive", "writerThreads", "writerMemory",
+        "triangulationCache", "triangulationCacheMemory"
+    };
+
+    // Conversion of the values of one section, with errors naming the key
+    class Reader {
+        public:
+            Reader(const std::map<std::string, std::string>& values) :
+                values(values) {}
+
+            const std::string& text(const char* key) const {
+                return values.at(key);
+            }
+            std::string word(const char* key) const {
+                return lower(text(key));
+            }
+            bool flag(const char* key) const {
+                const std::string w = word(key);
+                if (w == "true") return true;
+                if (w == "false") return false;
+                throw invalid(key, "true or false");
+            }
+            uint integer(const char* key, uint min = 0) const {
+                const std::string& t = text(key);
+                size_t end = 0;
+                long long v = -1;
+                try { v = std::stoll(t, &end); }
+                catch (std::exception& e) {}
+                if (end != t.size() || v < min || v > UINT32_MAX) {
+                    throw invalid(key, min > 0 ?
+                        "an integer of at least " + std::to_string(min) :
+                        "a non-negative integer");
+                }
+                return v;
+            }
+            // Finite number, no less than min (greater if strict)
+            double real(const char* key, double min = -INFINITY,
+                bool strict = false) const {
+                const std::string& t = text(key);
+                size_t end = 0;
+                double v = NAN;
+                try { v = std::stod(t, &end); }
+                catch (std::exception& e) {}
+                if (end != t.size() || !std::isfinite(v) || v < min ||
+                    (strict && v == min)) {
+                    throw invalid(key, !std::isfinite(min) ? "a number" :
+                        strict ? "a positive number" : "a non-negative number");
+                }
+                return v;
+            }
+            ConfigManager::InvalidValueException invalid(const char* key,
+                const std::string& expected) const {
+                return ConfigManager::InvalidValueException(
+                    "Invalid value \"" + text(key) + "\" for " + key +
+                    " (expected " + expected + ")");
+            }
+
+        private:
+            const std::map<std::string, std::string>& values;
+    };
+
+    // Keys converted on their own, so that jobs varying only these skip
+    // the conversion of the whole section
+    typedef void (*Setter)(const Reader&, JobSpec&);
+    const std::map<std::string, Setter> separateKeys = {
+        {"anisotropy", [](const Reader& r, JobSpec& s) {
+            s.irregular = !r.text("anisotropy").empty();
+            s.anisotropy = s.irregular ? r.real("anisotropy", 0, true) : 1;
+            if (s.shape == JobSpec::SPHERE && s.irregular &&
+                s.inputShape.empty()) {
+                throw ConfigManager::InvalidValueException(
+                    "Irregular sampling is not available for spheres");
+            }
+        }},
+        {"samples", [](const Reader& r, JobSpec& s) {
+            s.samples = r.integer("samples", 1);
+        }},
+        {"subdivision", [](const Reader& r, JobSpec& s) {
+            s.subdivision = r.integer("subdivision");
+        }},
+        {"radius", [](const Reader& r, JobSpec& s) {
+            s.radius = r.real("radius", 0, true);
+        }},
+        {"innerRadius", [](const Reader& r, JobSpec& s) {
+            s.innerRadius = r.real("innerRadius", 0, true);
+        }},
+        {"outerRadius", [](const Reader& r, JobSpec& s) {
+            s.outerRadius = r.real("outerRadius", 0, true);
+        }},
+        {"borderVariance", [](const Reader& r, JobSpec& s) {
+            s.borderVariance = r.real("borderVariance", 0);
+        }},
+        {"innerVariance", [](const Reader& r, JobSpec& s) {
+            s.innerVariance = r.real("innerVariance", 0);
+        }},
+        {"noise", [](const Reader& r, JobSpec& s) {
+            s.noise = r.real("noise", 0);
+        }},
+        {"scalarFrequency", [](const Reader& r, JobSpec& s) {
+            s.scalarFrequency = r.real("scalarFrequency");
+        }},
+        {"scalarAmplitude", [](const Reader& r, JobSpec& s) {
+            s.scalarAmplitude = r.real("scalarAmplitude");
+        }}
+    };
 }
 
+const ConfigManager::Values& ConfigManager::defaultValues() {
+    static const Values c = {
+        {"shape", "torus"},
+        {"name", "mesh"},
 
-ConfigManager::ConfigManager(std::string path, std::string section) {
-    std::ifstream ini(path);
+        {"interactive", "true"},
+        {"repeat", "1"},
+        {"inputPlane", ""},
+        {"inputShape", ""},
+        {"outFolder", "./"},
+        {"savePLY", "false"},
+        {"saveOBJ", "false"},
+        {"saveOFF", "false"},
+        {"exportUV", "false"},
+        {"exportControlGrid", "false"},
+        {"saveBundle", "false"},
+        {"stream", "false"},
+        {"compression", "none"},
+        {"bundleFormat", "ascii"},
+        {"writerThreads", "1"},
+        {"writerMemory", "1024"},
+        {"savePlane", "false"},
+        {"triangulationCache", ""},
+        {"triangulationCacheMemory", "256"},
 
-    // Parse file
+        {"anisotropy", ""},
+        {"sampling", "random"},
+        {"metric", ""},
+        {"samples", "64"},
+        {"radius", "1"},
+        {"innerRadius", "1"},
+        {"outerRadius", "2"},
+        {"centered", "false"},
+        {"subdivision", "3"},
+        {"elementType", "triangle"},
+
+        {"noise", "0"},
+        {"noiseType", "3d"},
+
+        {"seed", ""},
+        {"borderVariance", "1"},
+        {"innerVariance", "1"},
+
+        {"scalarField", "false"},
+        {"scalarHeader", "false"},
+        {"scalarFrequency", "1"},
+        {"scalarAmplitude", "1"},
+        {"scalarLaplacian", "false"},
+        {"scalarGradient", "false"},
+        {"scalarFaceGradient", "false"},
+        {"scalarHessian", "false"}
+    };
+    return c;
+}
+
+std::string ConfigManager::canonical(const std::string& key) {
+    static const std::unordered_map<std::string, std::string> keys = [] {
+        std::unordered_map<std::string, std::string> k;
+        for (const auto& d : defaultValues()) k[lower(d.first)] = d.first;
+        return k;
+    }();
+    const auto it = keys.find(lower(key));
+    return it == keys.end() ? "" : it->second;
+}
+
+
+ConfigManager::ConfigManager(std::string path) {
+    std::ifstream ini(path);
     if (!ini.is_open()) return;
     readOK = true;
-    for (char c : section) c = tolower(c);
-    defaultValues();
-    std::string key = "";
-    bool readConf = false;  // reading configuration
-    bool globals = true;    // reading globals
-    while (!ini.eof()) {
-        std::string val;
-        ini >> val;
-        if (val.empty() || val.front() == ';') {
-            // Discard the rest of the line
-            std::string a = "";
-            std::getline(ini, a);
-            continue;
+
+    // Parse file
+    Values *current = &globals;     // globals end at the first section
+    std::string line;
+    for (uint n = 1; std::getline(ini, line); ++n) {
+        // Comments start a line or follow a blank
+        for (size_t c = line.find_first_of(";#"); c != std::string::npos;
+            c = line.find_first_of(";#", c + 1)) {
+            if (c == 0 || isspace(line[c-1])) {
+                line.resize(c);
+                break;
+            }
         }
-        for (char c : val) c = tolower(c);
-
-        // Check section name against selected configuration
-        if (val.front() == '[' && val.back() == ']') {
-            globals = false;    // globals end at the first section
-            if (readConf) break;    // already read a full config, so stop
-            std::string sec = val.substr(1, val.length()-2);
-            if (section == "" || section == sec) {
-                readConf = true;
+        line = trim(line);
+        if (line.empty()) continue;
+        const std::string where = path + ':' + std::to_string(n) + ": ";
+
+        if (line.front() == '[' && line.back() == ']') {
+            const std::string sec = trim(line.substr(1, line.length()-2));
+            if (!byName.emplace(lower(sec), names.size()).second) {
+                syntaxErrors.push_back(where + "Duplicate section " + sec);
+                current = nullptr;
                 continue;
             }
+            names.push_back(sec);
+            values.emplace_back();
+            current = &values.back();
+            continue;
+        }
+
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            syntaxErrors.push_back(where + "Expected key = value");
+            continue;
+        }
+        const std::string key = canonical(trim(line.substr(0, eq)));
+        if (key.empty()) {
+            syntaxErrors.push_back(where + "Unknown key " +
+                trim(line.substr(0, eq)));
+            continue;
+        }
+        if (current) (*current)[key] = trim(line.substr(eq + 1));
+    }
+}
+
+
+JobSet ConfigManager::jobs(const std::string& section) const {
+    const auto it = byName.find(lower(section));
+    if (it == byName.end()) {
+        throw InvalidValueException("No configuration named " + section);
+    }
+    JobSet set;
+    // Overrides, then section, then globals, then defaults
+    Values& v = set.values;
+    v = overrides;
+    v.insert(values[it->second].begin(), values[it->second].end());
+    v.insert(globals.begin(), globals.end());
+    v.insert(defaultValues().begin(), defaultValues().end());
+
+    // Varying parameters, in the order of the keys
+    for (const auto& kv : v) {
+        const char* key = kv.first.c_str();
+        const std::string& t = kv.second;
+        const bool integer = integerKeys.count(kv.first);
+        const bool numeric = integer || realKeys.count(kv.first);
+        const bool list = (t.size() >= 2 && t.front() == '{' &&
+            t.back() == '}');
+        const bool draw = numeric && !t.empty() && t.back() == ')' &&
+            (lower(t).rfind("uniform(", 0) == 0 ||
+            lower(t).rfind("normal(", 0) == 0);
+        const bool range = numeric && !list && !draw &&
+            t.find(':') != std::string::npos;
+        if (!list && !draw && !range) continue;
+        if (fixedKeys.count(kv.first)) {
+            throw InvalidValueException(kv.first +
+                " cannot vary between the jobs of a configuration");
+        }
+
+        if (draw) {
+            const size_t open = t.find('(');
+            const std::vector<std::string> args =
+                split(t.substr(open + 1, t.size() - open - 2), ',');
+            JobSet::Draw d = {kv.first, lower(t)[0] == 'n', 0, 0, integer};
+            if (args.size() != 2 || !number(args[0], d.a) ||
+                !number(args[1], d.b) || (d.normal ? d.b < 0 : d.a > d.b)) {
+                throw InvalidValueException("Invalid distribution \"" + t +
+                    "\" for " + key + " (expected uniform(min, max) or " +
+                    "normal(mean, deviation))");
+            }
+            set.draws.push_back(d);
+            continue;
+        }
+
+        JobSet::Axis axis = {kv.first, {}};
+        if (list) {
+            axis.values = split(t.substr(1, t.size() - 2), ',');
         }
-        // Reading configuration
-        else if (readConf || globals) {
-            if (key.empty()) key = val;
-            else if (val != "=") {
-                configuration[key] = val;
-                key.clear();
+        else {
+            const std::vector<std::string> parts = split(t, ':');
+            double a, b, step = 1;
+            const bool geometric = (parts.size() == 3 &&
+                !parts[2].empty() && tolower(parts[2][0]) == 'x');
+            const bool ok = (parts.size() == 2 || parts.size() == 3) &&
+                number(parts[0], a) && number(parts[1], b) && a <= b &&
+                (parts.size() == 2 || number(geometric ?
+                parts[2].substr(1) : parts[2], step)) &&
+                (geometric ? step > 1 && a > 0 : step > 0);
+            if (!ok) {
+                throw InvalidValueException("Invalid range \"" + t +
+                    "\" for " + key + " (expected min:max, min:max:step " +
+                    "or min:max:xfactor)");
             }
+            for (size_t j = 0; ; ++j) {
+                const double x = geometric ? a * pow(step, j) : a + j * step;
+                if (x > b * (1 + 1e-12) + 1e-12) break;
+                const std::string value = format(x, integer);
+                if (axis.values.empty() || axis.values.back() != value)
+                    axis.values.push_back(value);
+                if (axis.values.size() > maxAxis) {
+                    throw InvalidValueException(std::string("Range of ") +
+                        key + " has too many values");
+                }
+            }
+        }
+        set.combinations *= axis.values.size();
+        set.axes.push_back(axis);
+    }
+
+    // Check every value of every sweep, and distributions at their center
+    Values center = set.resolve(0, 0);
+    for (const JobSet::Draw& d : set.draws) {
+        center[d.key] = format(d.normal ? d.a : (d.a + d.b) / 2, d.integer);
+    }
+    const std::string name = names[it->second];
+    set.first = convert(center, name);
+    for (const JobSet::Axis& axis : set.axes) {
+        Values w = center;
+        for (const std::string& value : axis.values) {
+            w[axis.key] = value;
+            convert(w, name);
         }
     }
+    set.repeat = set.first.repeat;
+    set.separate = true;
+    for (const JobSet::Axis& axis : set.axes)
+        set.separate = set.separate && separateKeys.count(axis.key);
+    for (const JobSet::Draw& d : set.draws)
+        set.separate = set.separate && separateKeys.count(d.key);
+    return set;
+}
+
+void ConfigManager::set(const std::string& key, const std::string& value) {
+    const std::string k = canonical(key);
+    if (k.empty()) throw InvalidValueException("Unknown key " + key);
+    overrides[k] = value;
+}
+
+
+JobSet::Values JobSet::resolve(size_t k, uint64_t key) const {
+    Values w = values;
+    for (const auto& kv : varying(k, key)) w[kv.first] = kv.second;
+    return w;
+}
+
+JobSet::Values JobSet::varying(size_t k, uint64_t key) const {
+    Values w;
+    // Combination, with the last sweep varying fastest
+    size_t c = k / std::max(1u, repeat);
+    for (auto axis = axes.rbegin(); axis != axes.rend(); ++axis) {
+        w[axis->key] = axis->values[c % axis->values.size()];
+        c /= axis->values.size();
+    }
+    for (const Draw& d : draws) {
+        // An independent stream for each parameter
+        RandPoint::Stream s(RandPoint::mix(key ^ RandPoint::hash(d.key)));
+        const double x = d.normal ? d.a + s.gaussian(d.b) : s.uniform(d.a, d.b);
+        w[d.key] = format(x, d.integer);
+    }
+    return w;
+}
+
+JobSpec JobSet::job(size_t k, uint64_t key) const {
+    if (!varies()) return first;
+    if (!separate) return ConfigManager::convert(resolve(k, key),
+        first.section);
+    // Only the varying keys, over the common settings
+    const Values w = varying(k, key);
+    const Reader r(w);
+    JobSpec s = first;
+    for (const auto& kv : w) separateKeys.at(kv.first)(r, s);
+    return s;
+}
+
+std::string JobSet::record(size_t k, uint64_t key) const {
+    const Values w = varying(k, key);
+    std::string text;
+    for (const Axis& axis : axes)
+        text += axis.key + " = " + w.at(axis.key) + '\n';
+    for (const Draw& d : draws)
+        text += d.key + " = " + w.at(d.key) + '\n';
+    return text;
+}
+
+uint64_t JobSet::hash(size_t k, uint64_t key) const {
+    std::string text;
+    for (const auto& kv : resolve(k, key)) {
+        if (!runKeys.count(kv.first))
+            text += kv.first + '=' + kv.second + '\n';
+    }
+    return RandPoint::mix(RandPoint::hash(text) ^ key);
+}
+
+
+JobSpec ConfigManager::convert(const Values& v, const std::string& section) {
+    const Reader r(v);
+
+    JobSpec s;
+    s.section = section;
+
+    const std::string shape = r.word("shape");
+    if (shape == "sphere") s.shape = JobSpec::SPHERE;
+    else if (shape == "torus") s.shape = JobSpec::TORUS;
+    else if (shape == "catenoid") s.shape = JobSpec::CATENOID;
+    else if (shape == "bezier") s.shape = JobSpec::BEZIER;
+    else throw r.invalid("shape", "sphere, torus, catenoid or bezier");
+    s.name = r.text("name");
+
+    // Mode and output
+    s.interactive = r.flag("interactive");
+    s.repeat = r.integer("repeat");
+    s.inputPlane = r.text("inputPlane");
+    s.inputShape = r.text("inputShape");
+    s.outFolder = r.text("outFolder");
+    s.savePLY = r.flag("savePLY");
+    s.saveOBJ = r.flag("saveOBJ");
+    s.saveOFF = r.flag("saveOFF");
+    s.saveBundle = r.flag("saveBundle");
+    s.savePlane = r.flag("savePlane");
+    s.exportUV = r.flag("exportUV");
+    const std::string grid = r.word("exportControlGrid");
+    if (grid != "separate" && grid != "false")
+        throw r.invalid("exportControlGrid", "separate or false");
+    s.separateControlGrid = (grid == "separate");
+    s.stream = r.flag("stream");
+    try {
+        s.zext = OutFile::extension(r.word("compression"));
+    }
+    catch (OutFile::UnsupportedCodecException e) {
+        throw InvalidValueException(std::string(e.what()) + ": " +
+            r.text("compression"));
+    }
+    const std::string format = r.word("bundleFormat");
+    if (format == "ascii") s.bundleFormat = PlyWriter::ASCII;
+    else if (format == "binary") s.bundleFormat = PlyWriter::BINARY;
+    else throw r.invalid("bundleFormat", "ascii or binary");
+    s.writerThreads = r.integer("writerThreads");
+    s.writerMemory = static_cast<size_t>(r.integer("writerMemory")) << 20;
+    s.triangulationCache = r.text("triangulationCache");
+    s.triangulationCacheMemory =
+        static_cast<size_t>(r.integer("triangulationCacheMemory")) << 20;
+
+    // Generation
+    try {
+        s.sampling.method = SurfaceSampling::method(r.word("sampling"));
+    }
+    catch (SurfaceSampling::UnknownMethodException e) {
+        throw InvalidValueException(std::string(e.what()) + ": " +
+            r.text("sampling"));
+    }
+    if (!r.text("metric").empty()) {
+        try {
+            s.sampling.metric = SurfaceSampling::parseMetric(r.text("metric"));
+            s.sampling.constantMetric = true;
+        }
+        catch (SurfaceSampling::InvalidMetricException e) {
+            throw InvalidValueException(e.what());
+        }
+    }
+    s.centered = r.flag("centered");
+    const std::string element = r.word("elementType");
+    if (element != "triangle" && element != "quad" && element != "square")
+        throw r.invalid("elementType", "triangle or quad");
+    s.quad = (element != "triangle");
+    s.fixedSeed = !r.text("seed").empty();
+    s.seed = s.fixedSeed ? r.integer("seed") : 0;
+
+    // Processing
+    const std::string noise = r.word("noiseType");
+    if (noise != "3d" && noise != "normal" && noise != "tangential")
+        throw r.invalid("noiseType", "3d, normal or tangential");
+    s.normalNoise = (noise == "3d" || noise == "normal");
+    s.tangentialNoise = (noise == "3d" || noise == "tangential");
+
+    // Scalar field
+    s.scalarField = r.flag("scalarField");
+    s.scalarHeader = r.flag("scalarHeader");
+    s.scalarLaplacian = r.flag("scalarLaplacian");
+    s.scalarGradient = r.flag("scalarGradient");
+    s.scalarHessian = r.flag("scalarHessian");
+    s.scalarFaceGradient = r.flag("scalarFaceGradient");
+
+    // Numeric parameters, which jobs may vary
+    for (const auto& key : separateKeys) key.second(r, s);
+    return s;
 }
\ No newline at end of file
@@ -1,16 +1,158 @@
+#ifndef CONFIGURATION_H
+#define CONFIGURATION_H
+
 #include <fstream>
 #include <map>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include "SurfaceSampling.hpp"
+#include "PlyWriter.hpp"
+
+// Settings of a configuration, converted and checked once
+struct JobSpec {
+    enum Shape { SPHERE, TORUS, CATENOID, BEZIER };
+
+    std::string section;
+    Shape shape;
+    std::string name;
+
+    // Mode and output
+    bool interactive;
+    uint repeat;
+    std::string inputPlane, inputShape;
+    std::string outFolder;
+    bool savePLY, saveOBJ, saveOFF, saveBundle, savePlane;
+    bool exportUV, separateControlGrid;
+    bool stream;
+    std::string zext;           // extension of the compression codec
+    PlyWriter::Format bundleFormat;
+    uint writerThreads;
+    size_t writerMemory;        // bytes
+    std::string triangulationCache;
+    size_t triangulationCacheMemory;    // bytes
+
+    // Generation
+    bool irregular;             // anisotropy given
+    double anisotropy;
+    SurfaceSampling::Options sampling;
+    uint samples;
+    double radius, innerRadius, outerRadius;
+    bool centered;
+    uint subdivision;
+    bool quad;
+    bool fixedSeed;
+    uint seed;
+    double borderVariance, innerVariance;
+
+    // Processing
+    double noise;
+    bool normalNoise, tangentialNoise;
+
+    // Scalar field
+    bool scalarField, scalarHeader;
+    double scalarFrequency, scalarAmplitude;
+    bool scalarLaplacian, scalarGradient, scalarHessian, scalarFaceGradient;
+};
+
+// Jobs of a configuration. Sweeps (ranges and lists of values) are expanded
+// as the cartesian product of their values, the last one varying fastest,
+// and every combination is run repeat times; random distributions are drawn
+// again for every job. Jobs are only resolved when asked for.
+class JobSet {
+    public:
+        inline size_t size() const { return combinations * repeat; }
+        // Whether any parameter changes between jobs
+        inline bool varies() const {
+            return !axes.empty() || !draws.empty();
+        }
+        // Settings common to all jobs (those of the first one, undrawn)
+        inline const JobSpec& common() const { return first; }
+
+        // Settings of job k, with draws from streams of the given key
+        JobSpec job(size_t k, uint64_t key) const;
+        // The varying parameters of job k, as "key = value" lines
+        std::string record(size_t k, uint64_t key) const;
+        // Hash of all parameters of job k that affect its outputs, and of
+        // the key
+        uint64_t hash(size_t k, uint64_t key) const;
+
+    private:
+        friend class ConfigManager;
+        typedef std::map<std::string, std::string> Values;
+        struct Axis {
+            std::string key;
+            std::vector<std::string> values;
+        };
+        struct Draw {
+            std::string key;
+            bool normal;        // else uniform
+            double a, b;        // bounds, or mean and deviation
+            bool integer;
+        };
 
+        Values values;
+        std::vector<Axis> axes;
+        std::vector<Draw> draws;
+        size_t combinations = 1;
+        uint repeat;
+        JobSpec first;
+        bool separate = false;  // only keys converted on their own vary
+
+        // All values of job k, or only the varying ones
+        Values resolve(size_t k, uint64_t key) const;
+        Values varying(size_t k, uint64_t key) const;
+};
+
+// INI file, read in a single pass. Keys given before the first section
+// apply to all configurations. Keys, section names and keywords among the
+// values are case-insensitive.
 class ConfigManager {
     public:
-        ConfigManager(std::string path = "configuration.ini",
-            std::string selection = "");
+        ConfigManager(std::string path = "configuration.ini");
+
+        // False if the file could not be read or has syntax errors
+        operator bool() { return readOK && syntaxErrors.empty(); }
+        const std::vector<std::string>& errors() const {
+            return syntaxErrors;
+        }
+        // Section names, in file order
+        const std::vector<std::string>& sections() const { return names; }
+
+        // Jobs of a section, over the globals and the defaults. All values
+        // are checked, except for those drawn from distributions.
+        JobSet jobs(const std::string& section) const;
+        // Replaces a key in every section (e.g. the sizes of a scaling
+        // study)
+        void set(const std::string& key, const std::string& value);
+
+        class InvalidValueException;
 
-        operator bool() { return readOK; }
-        std::string operator[] (const char* s) { return configuration.at(s); }
     private:
+        typedef JobSet::Values Values;
+        friend class JobSet;
+
         bool readOK = false;
-        std::map<std::string, std::string> configuration;
-        
-        void defaultValues();
-};
\ No newline at end of file
+        std::vector<std::string> syntaxErrors;
+        std::vector<std::string> names;
+        Values globals, overrides;
+        std::vector<Values> values;     // of each section
+        std::unordered_map<std::string, uint> byName;  // lowercase names
+
+        static const Values& defaultValues();
+        // Canonical spelling of a key, "" if unknown
+        static std::string canonical(const std::string& key);
+        static JobSpec convert(const Values& values,
+            const std::string& section);
+};
+
+class ConfigManager::InvalidValueException : public std::exception {
+    public:
+        InvalidValueException(std::string message) : message(message) {}
+        const char* what() { return message.c_str(); }
+    private:
+        std::string message;
+};
+
+#endif
\ No newline at end of file
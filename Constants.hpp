@@ -6,5 +6,7 @@
 const double SQRT3_2 = sqrt(3.0)/2.0;
 const double TWOPI = 2.0 * M_PI;
 const double PSI = (1.0 + sqrt(5.0)) / 2.0;
+// Coordinates closer than this are the same vertex
+const double WELD_TOLERANCE = 1e-9;
 
 #endif
\ No newline at end of file
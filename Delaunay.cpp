@@ -0,0 +1,301 @@
+#include "Delaunay.hpp"
+#include "RandPoint.hpp"
+#include "StripTriangulation.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+
+namespace {
+    inline double orient(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c) {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    // Position along a Hilbert curve on a 2^16 grid
+    uint64_t hilbert(uint32_t x, uint32_t y) {
+        uint64_t d = 0;
+        for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+            const uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+            d += uint64_t(s) * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = s - 1 - (x & (s - 1)) + (x & ~(s - 1));
+                    y = s - 1 - (y & (s - 1)) + (y & ~(s - 1));
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+}
+
+std::vector<uint> Delaunay::insertionOrder(
+    const std::vector<glm::dvec2>& points) {
+    const uint n = points.size();
+    if (n == 0) return std::vector<uint>();
+    glm::dvec2 lo = points[0], hi = points[0];
+    for (const auto& p : points) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    const double scale = 65535 / std::max(std::max(hi.x - lo.x, hi.y - lo.y),
+        1e-300);
+
+    // Each point goes one round earlier with probability 1/2; the order
+    // is fixed for a given point set
+    uint rounds = 0;
+    while ((1u << rounds) < n && rounds < 31) ++rounds;
+    RandPoint::Stream rng(RandPoint::mix(n));
+    std::vector<std::pair<uint64_t, uint>> key(n);
+    for (uint i = 0; i < n; ++i) {
+        uint r = 0;
+        for (uint32_t bits = rng.next(); r < rounds && (bits & 1);
+            bits >>= 1) ++r;
+        const uint32_t x = (points[i].x - lo.x) * scale;
+        const uint32_t y = (points[i].y - lo.y) * scale;
+        key[i] = std::make_pair(uint64_t(rounds - r) << 32 | hilbert(x, y),
+            i);
+    }
+    std::sort(key.begin(), key.end());
+    std::vector<uint> order(n);
+    for (uint i = 0; i < n; ++i) order[i] = key[i].second;
+    return order;
+}
+
+
+Delaunay::Delaunay(const std::vector<glm::dvec2>& points) :
+    pts(points), n(points.size()) {
+    // Super triangle, well outside the bounding box
+    glm::dvec2 lo(0), hi(1);
+    if (n > 0) lo = hi = points[0];
+    for (const auto& p : points) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    const glm::dvec2 c = (lo + hi) * .5;
+    const double s = std::max(std::max(hi.x - lo.x, hi.y - lo.y), 1e-9);
+    pts.push_back(c + glm::dvec2(-20 * s, -10 * s));
+    pts.push_back(c + glm::dvec2(20 * s, -10 * s));
+    pts.push_back(c + glm::dvec2(0, 20 * s));
+    tris.push_back({{n, n + 1, n + 2}, {NONE, NONE, NONE}});
+    alive.push_back(true);
+    inCavity.push_back(0);
+
+    tris.reserve(2 * n + 1);
+    for (uint i : insertionOrder(points)) insert(i);
+}
+
+bool Delaunay::inCircle(const Triangle& t, glm::dvec2 p) const {
+    const glm::dvec2 a = pts[t.v[0]] - p, b = pts[t.v[1]] - p,
+        c = pts[t.v[2]] - p;
+    const double det =
+        glm::dot(a, a) * (b.x * c.y - c.x * b.y) -
+        glm::dot(b, b) * (a.x * c.y - c.x * a.y) +
+        glm::dot(c, c) * (a.x * b.y - b.x * a.y);
+    return det > 0;
+}
+
+uint Delaunay::locate(glm::dvec2 p) const {
+    uint t = last;
+    // Visibility walk, starting from a different edge at each step so that
+    // it cannot cycle
+    for (uint step = 0; step < tris.size() + 3; ++step) {
+        bool moved = false;
+        for (uint j = 0; j < 3; ++j) {
+            const uint k = (j + step) % 3;
+            const Triangle& tr = tris[t];
+            if (tr.n[k] == NONE) continue;
+            if (orient(pts[tr.v[(k+1)%3]], pts[tr.v[(k+2)%3]], p) < 0) {
+                t = tr.n[k];
+                moved = true;
+                break;
+            }
+        }
+        if (!moved) return t;
+    }
+    return t;
+}
+
+void Delaunay::insert(uint i) {
+    const glm::dvec2 p = pts[i];
+    const uint t0 = locate(p);
+    // Repeated points are left out
+    for (uint k = 0; k < 3; ++k) {
+        if (pts[tris[t0].v[k]] == p) return;
+    }
+
+    // Cavity: triangles whose circumcircle contains p, grown so that all
+    // of its boundary is visible from p
+    struct Edge { uint a, b, outer; };
+    std::vector<Edge> boundary;
+    cavity.clear();
+    stack.assign(1, t0);
+    inCavity[t0] = 1;
+    cavity.push_back(t0);
+    while (!stack.empty()) {
+        const uint t = stack.back();
+        stack.pop_back();
+        for (uint k = 0; k < 3; ++k) {
+            const uint nb = tris[t].n[k];
+            if (nb != NONE && inCavity[nb]) continue;
+            const uint a = tris[t].v[(k+1)%3], b = tris[t].v[(k+2)%3];
+            if (nb != NONE && (inCircle(tris[nb], p) ||
+                orient(pts[a], pts[b], p) <= 0)) {
+                inCavity[nb] = 1;
+                cavity.push_back(nb);
+                stack.push_back(nb);
+            }
+        }
+    }
+    for (uint t : cavity) {
+        for (uint k = 0; k < 3; ++k) {
+            const uint nb = tris[t].n[k];
+            if (nb != NONE && inCavity[nb]) continue;
+            boundary.push_back({tris[t].v[(k+1)%3], tris[t].v[(k+2)%3], nb});
+        }
+    }
+    for (uint t : cavity) {
+        inCavity[t] = 0;
+        alive[t] = false;
+        freeList.push_back(t);
+    }
+
+    // Fan of new triangles (a, b, p)
+    std::vector<uint> created(boundary.size());
+    for (uint e = 0; e < boundary.size(); ++e) {
+        uint t;
+        if (!freeList.empty()) {
+            t = freeList.back();
+            freeList.pop_back();
+        }
+        else {
+            t = tris.size();
+            tris.push_back(Triangle());
+            alive.push_back(false);
+            inCavity.push_back(0);
+        }
+        const Edge& ed = boundary[e];
+        tris[t] = {{ed.a, ed.b, i}, {NONE, NONE, ed.outer}};
+        alive[t] = true;
+        created[e] = t;
+        if (ed.outer != NONE) {
+            Triangle& o = tris[ed.outer];
+            for (uint k = 0; k < 3; ++k) {
+                if (o.v[(k+1)%3] == ed.b && o.v[(k+2)%3] == ed.a)
+                    o.n[k] = t;
+            }
+        }
+    }
+    // Neighbors within the fan: across (b, p) is the triangle starting at
+    // b, across (p, a) the one ending at a
+    for (uint e = 0; e < boundary.size(); ++e) {
+        for (uint f = 0; f < boundary.size(); ++f) {
+            if (boundary[f].a == boundary[e].b)
+                tris[created[e]].n[0] = created[f];
+            if (boundary[f].b == boundary[e].a)
+                tris[created[e]].n[1] = created[f];
+        }
+    }
+    last = created[0];
+}
+
+std::vector<uint> Delaunay::faces() const {
+    std::vector<uint> f;
+    f.reserve(6 * n);
+    for (uint t = 0; t < tris.size(); ++t) {
+        if (!alive[t]) continue;
+        const uint* v = tris[t].v;
+        if (v[0] >= n || v[1] >= n || v[2] >= n) continue;
+        f.insert(f.end(), {v[0], v[1], v[2]});
+    }
+    return f;
+}
+
+
+std::vector<uint> Delaunay::triangulate(const std::vector<glm::dvec2>& points,
+    bool periodicU, bool periodicV) {
+    PROFILE_SCOPE("delaunay");
+    // Large point sets are triangulated in parallel strips
+    const auto backend = [](const std::vector<glm::dvec2>& p) {
+        return Delaunay(p).faces();
+    };
+    if (!periodicU && !periodicV) {
+        return StripTriangulation::triangulate(points, backend);
+    }
+
+    const uint n = points.size();
+    const bool periodic[2] = {periodicU, periodicV};
+    std::vector<glm::dvec2> base(points);
+    for (auto& p : base) {
+        for (uint d = 0; d < 2; ++d)
+            if (periodic[d]) p[d] -= std::floor(p[d]);
+    }
+    double margin = std::min(1., 3 / sqrt(std::max(n, 1u)));
+    while (true) {
+        // Copies across the seams, within the margin
+        std::vector<glm::dvec2> ext(base);
+        std::vector<uint> source(n);
+        for (uint i = 0; i < n; ++i) source[i] = i;
+        for (int su = -1; su <= 1; ++su) {
+            for (int sv = -1; sv <= 1; ++sv) {
+                if ((su == 0 && sv == 0) || (su && !periodicU) ||
+                    (sv && !periodicV)) continue;
+                for (uint i = 0; i < n; ++i) {
+                    const glm::dvec2 q = base[i] + glm::dvec2(su, sv);
+                    if (q.x < -margin || q.x > 1 + margin ||
+                        q.y < -margin || q.y > 1 + margin) continue;
+                    ext.push_back(q);
+                    source.push_back(i);
+                }
+            }
+        }
+        double vlo = 0, vhi = 1;
+        if (!periodicV) {
+            for (const auto& p : base) {
+                vlo = std::min(vlo, p.y);
+                vhi = std::max(vhi, p.y);
+            }
+        }
+
+        const std::vector<uint> all =
+            StripTriangulation::triangulate(ext, backend);
+        std::vector<uint> result;
+        result.reserve(2 * n * 3);
+        bool valid = true;
+        for (uint f = 0; f < all.size() / 3 && valid; ++f) {
+            const glm::dvec2 a = ext[all[3*f]], b = ext[all[3*f+1]],
+                c = ext[all[3*f+2]];
+            // The copy with its smallest vertex in the square
+            glm::dvec2 m = a;
+            for (const glm::dvec2& q : {b, c}) {
+                if (q.x < m.x || (q.x == m.x && q.y < m.y)) m = q;
+            }
+            if ((periodicU && (m.x < 0 || m.x >= 1)) ||
+                (periodicV && (m.y < 0 || m.y >= 1))) continue;
+
+            // Its circumcircle, as far as it reaches into the domain, must
+            // lie where points were replicated
+            const double d = 2 * orient(a, b, c);
+            const glm::dvec2 ab = b - a, ac = c - a;
+            const glm::dvec2 center = a + glm::dvec2(
+                ac.y * glm::dot(ab, ab) - ab.y * glm::dot(ac, ac),
+                ab.x * glm::dot(ac, ac) - ac.x * glm::dot(ab, ab)) / d;
+            const double r = glm::length(center - a);
+            double reachU = r;
+            if (!periodicV) {
+                const double out = std::max(0.,
+                    std::max(vlo - center.y, center.y - vhi));
+                reachU = sqrt(std::max(0., r * r - out * out));
+            }
+            if ((periodicU && (center.x - reachU < -margin ||
+                center.x + reachU > 1 + margin)) ||
+                (periodicV && (center.y - r < -margin ||
+                center.y + r > 1 + margin))) {
+                valid = false;
+                break;
+            }
+            result.insert(result.end(), {source[all[3*f]],
+                source[all[3*f+1]], source[all[3*f+2]]});
+        }
+        if (valid || margin >= 1) return result;
+        margin = std::min(1., 2 * margin);
+    }
+}
\ No newline at end of file
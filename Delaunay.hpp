@@ -0,0 +1,52 @@
+#ifndef DELAUNAY_H
+#define DELAUNAY_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+
+// Incremental (Bowyer-Watson) Delaunay triangulation of points of the unit
+// square. Points are inserted in rounds of doubling size (BRIO), each
+// sorted along a Hilbert curve, so that walking from the last triangle
+// finds the next point in a few steps.
+// With periodic coordinates the result triangulates the flat cylinder or
+// torus: points are replicated across the seams within a margin, and each
+// triangle is kept once, for the copy whose lexicographically smallest
+// vertex lies in the unit square. The margin is doubled until every kept
+// circumcircle fits in the replicated region. Large point sets are
+// triangulated in parallel strips (see StripTriangulation).
+class Delaunay {
+    public:
+        // Counterclockwise triangles, as indices into points
+        static std::vector<uint> triangulate(
+            const std::vector<glm::dvec2>& points,
+            bool periodicU = false, bool periodicV = false);
+        static std::vector<uint> insertionOrder(
+            const std::vector<glm::dvec2>& points);
+
+    private:
+        static const uint NONE = -1;
+        struct Triangle {
+            uint v[3];
+            uint n[3];  // neighbor across the edge opposite v[k]
+        };
+
+        Delaunay(const std::vector<glm::dvec2>& points);
+        void insert(uint p);
+        uint locate(glm::dvec2 p) const;
+        bool inCircle(const Triangle& t, glm::dvec2 p) const;
+        // Triangles without super vertices
+        std::vector<uint> faces() const;
+
+        std::vector<glm::dvec2> pts;    // input, then 3 super vertices
+        const uint n;
+        std::vector<Triangle> tris;
+        std::vector<bool> alive;
+        std::vector<uint> freeList;
+        uint last = 0;
+        // Scratch space for insertions
+        std::vector<char> inCavity;
+        std::vector<uint> cavity, stack;
+};
+
+#endif
\ No newline at end of file
@@ -20,6 +20,25 @@ DifferentialQuantities::DifferentialQuantities(glm::dvec3 xu, glm::dvec3 xv,
 	N = glm::dot(xvv, nrm);
 }
 
+glm::dmat2 DifferentialQuantities::anisotropicMetric(double anisotropy)
+	const {
+	const glm::dmat2 g1 = metric();
+	// Principal curvatures solve det(II - k I) = 0
+	const double H = meanCurvature(), K = gaussianCurvature();
+	const double disc = H*H - K;
+	if (!(disc > 1e-12 * (H*H + 1)) || anisotropy == 1) return g1;
+	const double k = (H >= 0) ? H + sqrt(disc) : H - sqrt(disc);
+	// Principal direction in UV, from either row of (II - k I)
+	glm::dvec2 w1(-(M - k*F), L - k*E), w2(N - k*G, -(M - k*F));
+	glm::dvec2 w = (glm::dot(w1, w1) > glm::dot(w2, w2)) ? w1 : w2;
+	const glm::dvec2 gw = g1 * w;
+	const double len2 = glm::dot(w, gw);
+	if (!(len2 > 0)) return g1;
+	// Add the stretch along the unit principal direction
+	const double a = anisotropy * anisotropy - 1;
+	return g1 + glm::dmat2(gw * (gw.x / len2), gw * (gw.y / len2)) * a;
+}
+
 glm::dvec3 DifferentialQuantities::gradient(double f, double fu, double fv)
 	const {
     const glm::dvec2 df(fu, fv);
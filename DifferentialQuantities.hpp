@@ -16,6 +16,11 @@ class DifferentialQuantities {
             glm::dvec3 xuu, glm::dvec3 xuv, glm::dvec3 xvv);
 
         glm::dvec3 normal() const { return nrm; }
+        double areaElement() const { return sqrt(E*G - F*F); }
+        glm::dmat2 metric() const { return glm::dmat2(E, F, F, G); }
+        // First fundamental form with lengths along the direction of
+        // largest principal curvature scaled by the given ratio
+        glm::dmat2 anisotropicMetric(double anisotropy) const;
         double meanCurvature() const { return (G*L - 2*F*M + E*N) / (detg * 2); }
         double gaussianCurvature() const { return (L*N - M*M) / detg; }
 
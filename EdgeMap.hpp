@@ -0,0 +1,88 @@
+#ifndef EDGEMAP_H
+#define EDGEMAP_H
+
+#include <vector>
+#include <cstdint>
+
+// Map from edge keys to values, with open addressing in a single array, so
+// that inserting and erasing edges does not allocate once the map is sized
+// for its edges. Keys are any 64-bit values but UINT64_MAX.
+template <typename Value>
+class EdgeMap {
+    public:
+        EdgeMap(size_t expected = 0) { rehash(expected); }
+
+        inline size_t size() const { return count; }
+
+        Value* find(uint64_t key) {
+            for (size_t i = home(key); ; i = (i + 1) & mask) {
+                if (slots[i].key == key) return &slots[i].value;
+                if (slots[i].key == empty) return nullptr;
+            }
+        }
+
+        // Inserts a default value for a new key
+        Value& operator[](uint64_t key) {
+            if (2 * (count + 1) > slots.size()) rehash(count + 1);
+            size_t i = home(key);
+            for (; slots[i].key != empty; i = (i + 1) & mask) {
+                if (slots[i].key == key) return slots[i].value;
+            }
+            slots[i].key = key;
+            slots[i].value = Value();
+            ++count;
+            return slots[i].value;
+        }
+
+        void erase(uint64_t key) {
+            size_t i = home(key);
+            for (; slots[i].key != key; i = (i + 1) & mask) {
+                if (slots[i].key == empty) return;
+            }
+            // Shift back the following keys that probed past the hole
+            for (size_t j = (i + 1) & mask; slots[j].key != empty;
+                j = (j + 1) & mask) {
+                const size_t h = home(slots[j].key);
+                if (((j - h) & mask) >= ((j - i) & mask)) {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i].key = empty;
+            --count;
+        }
+
+    private:
+        struct Slot {
+            uint64_t key;
+            Value value;
+        };
+        static const uint64_t empty = UINT64_MAX;
+        std::vector<Slot> slots;
+        size_t mask = 0, count = 0;
+        uint shift = 64;
+
+        // Fibonacci hashing: the top bits of the key times 2^64 / phi
+        inline size_t home(uint64_t key) const {
+            return (key * 0x9E3779B97F4A7C15ull) >> shift;
+        }
+
+        // At most half full for at least n keys
+        void rehash(size_t n) {
+            size_t capacity = 16;
+            shift = 60;
+            while (capacity < 2 * n) {
+                capacity *= 2;
+                --shift;
+            }
+            std::vector<Slot> old(capacity, Slot{empty, Value()});
+            old.swap(slots);
+            mask = capacity - 1;
+            count = 0;
+            for (const Slot& s : old) {
+                if (s.key != empty) (*this)[s.key] = s.value;
+            }
+        }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "FieldBundle.hpp"
+#include "ChunkedOutput.hpp"
+#include "CompressedStream.hpp"
+#include "Profiler.hpp"
+
+FieldBundle::FieldBundle(const Mesh* m) : mesh(m) {}
+
+void FieldBundle::add(std::string name, const ScalarField* field) {
+    auto& cols = field->onFaces() ? faceCols : vertCols;
+    cols.push_back({name, field, nullptr, 0});
+}
+
+void FieldBundle::add(std::string name, const VectorField* field) {
+    auto& cols = field->onFaces() ? faceCols : vertCols;
+    const char* suffix[3] = {"_x", "_y", "_z"};
+    for (uint k = 0; k < 3; ++k) {
+        cols.push_back({name + suffix[k], nullptr, field, k});
+    }
+}
+
+void FieldBundle::write(std::string path, PlyWriter::Format format) const {
+    PROFILE_SCOPE("writeBundle");
+    // Open file
+    OutFile file(path);
+    if (!file.is_open()) throw Mesh::FileOpenException();
+    PlyWriter ply(file, format);
+
+    const uint vn = mesh->vertNum(), fn = mesh->faceNum();
+    const uint ac = mesh->attribComponents();
+
+    // Header
+    if (!mesh->name.empty()) ply.comment(mesh->name);
+    ply.element("vertex", vn);
+    for (const std::string& att : mesh->attribNames()) ply.property(att);
+    for (const Column& c : vertCols) ply.property(c.name);
+    ply.element("face", fn);
+    ply.listProperty("vertex_indices");
+    for (const Column& c : faceCols) ply.property(c.name);
+    ply.endHeader();
+
+    // Write vertices along with their fields
+    ChunkedOutput::write(file, vn, [&](std::ostream& out, size_t i) {
+        PlyWriter row = ply.rows(out);
+        for (uint j = 0; j < ac; ++j) row.value(mesh->cAttrib(i, j));
+        for (const Column& c : vertCols) row.value(c.get(i));
+        row.endRow();
+    });
+
+    // Write faces along with their fields
+    ChunkedOutput::write(file, fn, [&](std::ostream& out, size_t i) {
+        PlyWriter row = ply.rows(out);
+        const uint f[3] = {
+            mesh->cFacei(i, 0),
+            mesh->cFacei(i, 1),
+            mesh->cFacei(i, 2)
+        };
+        row.list(f, 3);
+        for (const Column& c : faceCols) row.value(c.get(i));
+        row.endRow();
+    });
+
+    // Close file
+    file.close();
+    if (!file) throw Mesh::FileWriteException();
+}
\ No newline at end of file
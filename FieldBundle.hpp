@@ -0,0 +1,38 @@
+#ifndef FIELDBUNDLE_H
+#define FIELDBUNDLE_H
+
+#include "Mesh.hpp"
+#include "ScalarField.hpp"
+#include "VectorField.hpp"
+#include "PlyWriter.hpp"
+
+// Writes a mesh together with any number of fields as a single PLY file.
+// Fields defined on vertices become vertex properties, fields defined on
+// faces become face properties. Fields are not owned by the bundle.
+class FieldBundle {
+    public:
+        FieldBundle(const Mesh* m);
+
+        void add(std::string name, const ScalarField* field);
+        // Vector fields are split into the properties name_x, name_y, name_z
+        void add(std::string name, const VectorField* field);
+
+        void write(std::string path,
+            PlyWriter::Format format = PlyWriter::ASCII) const;
+
+    private:
+        struct Column {
+            std::string name;
+            const ScalarField* scalar;
+            const VectorField* vector;
+            uint component;
+            inline double get(uint i) const {
+                return scalar ? scalar->getValue(i) :
+                    vector->getValue(i)[component];
+            }
+        };
+        const Mesh* mesh;
+        std::vector<Column> vertCols, faceCols;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "JobScheduler.hpp"
+#include <thread>
+#include <algorithm>
+#include <omp.h>
+
+JobScheduler::JobScheduler(uint workers) : workers(std::max(1u, workers)) {}
+
+void JobScheduler::add(size_t count, Job job, bool mainThread) {
+    if (count > 0) ranges.push_back({job, count, mainThread});
+}
+
+size_t JobScheduler::jobCount() const {
+    size_t n = 0;
+    for (const Range& r : ranges) n += r.count;
+    return n;
+}
+
+void JobScheduler::run() {
+    // Deal the jobs in blocks, so each worker starts on neighbouring jobs
+    queues = new Queue[workers];
+    size_t n = 0;
+    for (const Range& r : ranges) if (!r.pinned) n += r.count;
+    size_t start = 0;   // of the current range among the jobs dealt
+    for (uint r = 0; r < ranges.size(); ++r) {
+        if (ranges[r].pinned) continue;
+        const size_t end = start + ranges[r].count;
+        for (uint w = 0; w < workers; ++w) {
+            const size_t a = std::max(start, w * n / workers);
+            const size_t b = std::min(end, (w + 1) * n / workers);
+            if (a < b) queues[w].blocks.push_back({r, a - start, b - start});
+        }
+        start = end;
+    }
+
+    // Share of the OpenMP threads of each worker
+    const uint total = omp_get_max_threads();
+    auto share = [&](uint w) {
+        return std::max(1u, total / workers + (w < total % workers));
+    };
+    std::vector<std::thread> threads;
+    for (uint w = 1; w < workers; ++w)
+        threads.emplace_back(&JobScheduler::work, this, w, share(w));
+    work(0, share(0));
+    for (std::thread& t : threads) t.join();
+    omp_set_num_threads(total);
+
+    delete[] queues;
+    queues = nullptr;
+    ranges.clear();
+}
+
+void JobScheduler::work(uint w, uint threads) {
+    // The number of threads is per thread, so this only affects the
+    // parallel regions started by this worker
+    omp_set_num_threads(threads);
+    if (w == 0) {
+        for (const Range& r : ranges) {
+            if (!r.pinned) continue;
+            for (size_t i = 0; i < r.count; ++i) r.job(i);
+        }
+    }
+    // No job adds jobs, so a worker that finds all queues empty is done
+    Block job;
+    while (pop(w, job) || (steal(w) && pop(w, job)))
+        ranges[job.range].job(job.first);
+}
+
+bool JobScheduler::pop(uint w, Block& job) {
+    std::lock_guard<std::mutex> lock(queues[w].mtx);
+    auto& blocks = queues[w].blocks;
+    if (blocks.empty()) return false;
+    job = blocks.front();
+    if (++blocks.front().first == blocks.front().last) blocks.pop_front();
+    return true;
+}
+
+bool JobScheduler::steal(uint w) {
+    for (uint k = 1; k < workers; ++k) {
+        Queue& victim = queues[(w + k) % workers];
+        Block loot;
+        {
+            std::lock_guard<std::mutex> lock(victim.mtx);
+            if (victim.blocks.empty()) continue;
+            Block& b = victim.blocks.back();
+            loot = {b.range, b.first + (b.last - b.first) / 2, b.last};
+            b.last = loot.first;
+            if (b.first == b.last) victim.blocks.pop_back();
+        }
+        std::lock_guard<std::mutex> lock(queues[w].mtx);
+        queues[w].blocks.push_back(loot);
+        return true;
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <sys/types.h>
+
+// Work-stealing pool for independent jobs. Jobs come in ranges of indices,
+// which are never expanded: they are dealt to the workers in contiguous
+// blocks, in the order they were added; each worker runs its own blocks
+// front to back and, once it is out of work, steals the back half of the
+// last block of another worker. The OpenMP thread budget of the caller is
+// split between the workers, so parallel kernels inside a job use their
+// share of the cores instead of oversubscribing them. The thread calling
+// run() is one of the workers, and the only one to run jobs pinned to it
+// (e.g. those opening a window).
+class JobScheduler {
+    public:
+        typedef std::function<void(size_t)> Job;
+
+        JobScheduler(uint workers = 1);
+
+        // Jobs job(0), ..., job(count-1)
+        void add(size_t count, Job job, bool mainThread = false);
+        inline void add(std::function<void()> job, bool mainThread = false) {
+            add(1, [job](size_t) { job(); }, mainThread);
+        }
+        // Runs all jobs added so far, returns once they have completed
+        void run();
+
+        inline uint workerCount() const { return workers; }
+        size_t jobCount() const;
+
+    private:
+        struct Range {
+            Job job;
+            size_t count;
+            bool pinned;
+        };
+        // Indices [first, last) of a range
+        struct Block {
+            uint range;
+            size_t first, last;
+        };
+        struct Queue {
+            std::deque<Block> blocks;
+            std::mutex mtx;
+        };
+        const uint workers;
+        std::vector<Range> ranges;
+        Queue *queues = nullptr;
+
+        void work(uint w, uint threads);
+        bool pop(uint w, Block& job);
+        bool steal(uint w);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "LowDiscrepancy.hpp"
+#include "RandPoint.hpp"
+#include <algorithm>
+
+// Digits such that base^digits covers 32 bit indices
+const uint LowDiscrepancy::HALTON_DIGITS[2] = {32, 21};
+
+namespace {
+    const uint BASES[2] = {2, 3};
+
+    inline uint32_t reverseBits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+        x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Nested uniform scramble on reversed bits (Laine-Karras hash)
+    inline uint32_t owenScramble(uint32_t x, uint32_t seed) {
+        x = reverseBits(x);
+        x += seed;
+        x ^= x * 0x6C50B47Cu;
+        x ^= x * 0xB82F1E52u;
+        x ^= x * 0xC7AFE638u;
+        x ^= x * 0x8D22F6E6u;
+        return reverseBits(x);
+    }
+
+    // First two Sobol dimensions: van der Corput, then the direction
+    // numbers of x + 1
+    inline uint32_t sobol(uint32_t i, uint dim) {
+        uint32_t r = 0, v = 1u << 31;
+        for (; i; i >>= 1, v = dim ? v ^ (v >> 1) : v >> 1) {
+            if (i & 1) r ^= v;
+        }
+        return r;
+    }
+}
+
+LowDiscrepancy::LowDiscrepancy(Sequence sequence, uint64_t key) :
+    sequence(sequence), key(key) {
+    RandPoint::Stream rng(key);
+    for (uint d = 0; d < 2; ++d) {
+        seed[d] = rng.next();
+        if (sequence != HALTON) continue;
+        // Shuffled digits for each position
+        const uint b = BASES[d];
+        perm[d].resize(HALTON_DIGITS[d] * b);
+        for (uint j = 0; j < HALTON_DIGITS[d]; ++j) {
+            unsigned char* p = &perm[d][j * b];
+            for (uint k = 0; k < b; ++k) p[k] = k;
+            for (uint k = b - 1; k > 0; --k)
+                std::swap(p[k], p[rng.next() % (k + 1)]);
+        }
+    }
+}
+
+glm::dvec2 LowDiscrepancy::point(uint32_t i) const {
+    double x[2];
+    for (uint d = 0; d < 2; ++d) {
+        if (sequence == SOBOL) {
+            x[d] = owenScramble(sobol(i, d), seed[d]) / 4294967296.0;
+            continue;
+        }
+        // Permuted radical inverse, including the leading zero digits
+        const uint b = BASES[d];
+        const unsigned char* p = perm[d].data();
+        uint32_t n = i;
+        double f = 1.0 / b, r = 0;
+        for (uint j = 0; j < HALTON_DIGITS[d]; ++j, f /= b) {
+            r += p[j * b + n % b] * f;
+            n /= b;
+        }
+        x[d] = std::min(r, 1 - 1e-16);
+    }
+    return glm::dvec2(x[0], x[1]);
+}
+
+void LowDiscrepancy::points(uint32_t first, uint n, glm::dvec2* out) const {
+    #pragma omp parallel for
+    for (uint i = 0; i < n; ++i) out[i] = point(first + i);
+}
+
+LowDiscrepancy LowDiscrepancy::rescrambled() const {
+    return LowDiscrepancy(sequence, RandPoint::mix(key));
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef LOWDISCREPANCY_H
+#define LOWDISCREPANCY_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Scrambled low-discrepancy sequences in the unit square. Point i depends
+// only on i and the scrambling key, so any subset of a set can be computed
+// independently (and in parallel).
+class LowDiscrepancy {
+    public:
+        enum Sequence {
+            SOBOL,      // Owen-scrambled Sobol (hash based, Burley 2020)
+            HALTON      // bases 2 and 3, random digit permutations
+        };
+
+        LowDiscrepancy(Sequence sequence, uint64_t key);
+
+        glm::dvec2 point(uint32_t i) const;
+        void points(uint32_t first, uint n, glm::dvec2* out) const;
+        // Same sequence with an independent scrambling
+        LowDiscrepancy rescrambled() const;
+
+    private:
+        static const uint HALTON_DIGITS[2];
+        const Sequence sequence;
+        const uint64_t key;
+        uint32_t seed[2];                // Sobol scrambling, per dimension
+        std::vector<unsigned char> perm[2];  // Halton permutation per digit
+};
+
+#endif
\ No newline at end of file
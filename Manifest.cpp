@@ -0,0 +1,233 @@
+#include "Manifest.hpp"
+#include "RandPoint.hpp"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+    std::string hex(uint64_t x) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx",
+            static_cast<unsigned long long>(x));
+        return text;
+    }
+}
+
+Manifest::Manifest(std::string file, size_t jobs, std::string selection) :
+    file(file), jobs(jobs), selection(selection) {}
+
+Manifest::~Manifest() {
+    if (journal.is_open()) journal.close();
+}
+
+std::string Manifest::id(const Entry& e) {
+    return e.config + '\t' + std::to_string(e.index);
+}
+
+void Manifest::writeHeader(std::ostream& out) const {
+    out << "# nicemesh manifest\n";
+    out << "# file\t" << file << '\n';
+    out << "# jobs\t" << jobs << '\n';
+    out << "# selection\t" << selection << '\n';
+}
+
+void Manifest::writeEntry(std::ostream& out, const Entry& e) {
+    out << e.job << '\t' << e.config << '\t' << e.index << '\t' << e.seed <<
+        '\t' << e.name << '\t' << (e.ok ? "ok" : "failed") << '\t' <<
+        hex(e.params);
+    for (const auto& f : e.files) out << '\t' << f.first << '\t' <<
+        hex(f.second);
+    out << '\n';
+}
+
+
+void Manifest::open(const std::string& journalPath) {
+    path = journalPath;
+    std::ifstream test(path);
+    const bool exists = test.is_open();
+    test.close();
+    if (exists) {
+        // Keep the run's header, read the entries of the previous runs
+        Manifest old;
+        old.read(path);
+        for (const Entry& e : old.done) previous[id(e)] = e;
+    }
+    journal.open(path, std::ios::app);
+    if (!journal.is_open()) throw FileException("Cannot write manifest " + path);
+    if (!exists) {
+        writeHeader(journal);
+        journal.flush();
+    }
+}
+
+bool Manifest::reuse(const Entry& job) {
+    const auto it = previous.find(id(job));
+    if (it == previous.end()) return false;
+    const Entry& e = it->second;
+    if (!e.ok || e.params != job.params || e.seed != job.seed ||
+        e.name != job.name || e.files.empty()) return false;
+    for (const auto& f : e.files) {
+        uint64_t sum;
+        if (!checksum(f.first, sum) || sum != f.second) return false;
+    }
+    Entry kept = e;
+    kept.job = job.job;     // jobs before may have been added or removed
+    add(kept);
+    return true;
+}
+
+void Manifest::add(const Entry& entry) {
+    std::lock_guard<std::mutex> lock(mtx);
+    done.push_back(entry);
+    if (journal.is_open()) {
+        writeEntry(journal, entry);
+        journal.flush();
+    }
+}
+
+void Manifest::close() {
+    if (!journal.is_open()) return;
+    journal.close();
+    // Replace the journal at once, so it is valid at any time
+    const std::string temp = path + ".tmp";
+    write(temp);
+    if (rename(temp.c_str(), path.c_str()) != 0)
+        throw FileException("Cannot write manifest " + path);
+}
+
+
+void Manifest::write(const std::string& target) {
+    std::lock_guard<std::mutex> lock(mtx);
+    // Latest entry of each job, in job order
+    std::map<std::string, Entry> latest;
+    for (const Entry& e : done) latest[id(e)] = e;
+    done.clear();
+    for (const auto& l : latest) done.push_back(l.second);
+    std::sort(done.begin(), done.end(),
+        [](const Entry& a, const Entry& b) { return a.job < b.job; });
+
+    std::ofstream out(target);
+    if (!out.is_open()) throw FileException("Cannot write manifest " + target);
+    writeHeader(out);
+    for (const Entry& e : done) writeEntry(out, e);
+    out.close();
+    if (out.fail()) throw FileException("Cannot write manifest " + target);
+}
+
+void Manifest::read(const std::string& in) {
+    std::ifstream stream(in);
+    if (!stream.is_open()) throw FileException("Cannot read manifest " + in);
+    std::lock_guard<std::mutex> lock(mtx);
+    done.clear();
+    std::string line;
+    for (uint n = 1; std::getline(stream, line); ++n) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        for (std::string f; std::getline(ss, f, '\t'); ) fields.push_back(f);
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            if (fields.size() != 2) continue;
+            if (fields[0] == "# file") file = fields[1];
+            else if (fields[0] == "# jobs") jobs = std::stoull(fields[1]);
+            else if (fields[0] == "# selection") selection = fields[1];
+            continue;
+        }
+        Entry e;
+        try {
+            if (fields.size() < 7 || fields.size() % 2 == 0)
+                throw std::exception();
+            e.job = std::stoull(fields[0]);
+            e.config = fields[1];
+            e.index = std::stoull(fields[2]);
+            e.seed = std::stoul(fields[3]);
+            e.name = fields[4];
+            e.ok = (fields[5] == "ok");
+            e.params = std::stoull(fields[6], nullptr, 16);
+            for (size_t f = 7; f < fields.size(); f += 2) {
+                e.files.push_back({fields[f],
+                    std::stoull(fields[f+1], nullptr, 16)});
+            }
+        }
+        catch (std::exception& ex) {
+            // A journal may end with a partly written line
+            if (stream.peek() == EOF) break;
+            throw FileException("Invalid manifest entry at " + in + ':' +
+                std::to_string(n));
+        }
+        done.push_back(e);
+    }
+}
+
+std::vector<size_t> Manifest::merge(const std::vector<std::string>& inputs,
+    const std::string& output) {
+    Manifest merged;
+    std::map<size_t, Entry> byJob;
+    for (uint i = 0; i < inputs.size(); ++i) {
+        Manifest part;
+        part.read(inputs[i]);
+        if (i == 0) {
+            merged.file = part.file;
+            merged.jobs = part.jobs;
+        }
+        else if (part.file != merged.file || part.jobs != merged.jobs) {
+            throw FileException("Manifest " + inputs[i] +
+                " comes from a different run than " + inputs[0]);
+        }
+        // Journals may hold several entries of a job, the last one wins
+        std::map<size_t, Entry> latest;
+        for (const Entry& e : part.done) latest[e.job] = e;
+        for (const auto& l : latest) {
+            const Entry& e = l.second;
+            const auto it = byJob.find(e.job);
+            if (it == byJob.end()) byJob[e.job] = e;
+            // The same job run twice must have given the same mesh
+            else if (it->second.config != e.config ||
+                it->second.index != e.index ||
+                it->second.params != e.params) {
+                throw FileException("Manifests disagree on job " +
+                    std::to_string(e.job));
+            }
+            else if (e.ok && !it->second.ok) it->second = e;
+        }
+    }
+    merged.selection = "merge of " + std::to_string(inputs.size()) +
+        " manifests";
+    std::vector<size_t> missing;
+    for (size_t j = 0; j < merged.jobs; ++j) {
+        const auto it = byJob.find(j);
+        if (it == byJob.end()) missing.push_back(j);
+        else merged.done.push_back(it->second);
+    }
+    merged.write(output);
+    return missing;
+}
+
+bool Manifest::checksum(const std::string& path, uint64_t& sum) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    // Multiply-xorshift over 64-bit words, four lanes to keep the
+    // multipliers busy, then the byte count
+    std::vector<char> buffer(1 << 20);
+    uint64_t lane[4] = {1, 2, 3, 4};
+    uint64_t bytes = 0;
+    size_t n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), f)) > 0) {
+        // Zero padding of the last block is told apart by the count
+        const size_t words = (n + 7) / 8;
+        std::fill(buffer.begin() + n, buffer.begin() + words * 8, 0);
+        for (size_t i = 0; i < words; ++i) {
+            uint64_t w;
+            memcpy(&w, buffer.data() + 8 * i, 8);
+            uint64_t& h = lane[i % 4];
+            h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+        }
+        bytes += n;
+    }
+    const bool ok = !ferror(f);
+    fclose(f);
+    sum = RandPoint::mix(bytes);
+    for (uint64_t h : lane) sum = RandPoint::mix(sum ^ h);
+    return ok;
+}
\ No newline at end of file
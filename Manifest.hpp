@@ -0,0 +1,88 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+#include <sys/types.h>
+
+// Record of the jobs run by a process: which meshes of which configs were
+// generated, under which seeds and parameters, and the checksums of the
+// files they produced. Jobs are numbered across all configs of a run, so
+// the manifests of processes that each ran a part of the jobs can be
+// merged into the manifest of the whole run.
+// The manifest is also a journal: entries are appended as soon as the
+// outputs of a job are written, so after an interrupted run or a change
+// of the configuration, jobs whose parameters are unchanged and whose
+// files are intact can be skipped.
+// Text format: "# key<TAB>value" header lines, then one line per job with
+// tab-separated fields, followed by (path, checksum) pairs; the last line
+// of a job wins.
+class Manifest {
+    public:
+        struct Entry {
+            size_t job;             // among all jobs of the run
+            std::string config;
+            size_t index;           // among the jobs of the config
+            uint seed;
+            std::string name;       // of the outputs
+            bool ok;                // generated and written without errors
+            uint64_t params;        // hash of the parameters and job key
+            std::vector<std::pair<std::string, uint64_t>> files;
+        };
+
+        Manifest(std::string file = "", size_t jobs = 0,
+            std::string selection = "");
+        ~Manifest();
+
+        // Continue the journal at path, reading the entries it holds
+        void open(const std::string& path);
+        // Whether an entry of the journal matches the parameters of the job
+        // and its files are unchanged; if so it is recorded again
+        bool reuse(const Entry& job);
+        void add(const Entry& entry);   // safe to call from several threads
+        // Rewrite the journal with only the latest entry of each job
+        void close();
+
+        void write(const std::string& path);
+        void read(const std::string& path);
+
+        // Manifest of the jobs recorded by any of the inputs, which must
+        // come from the same run. Returns the indices of missing jobs.
+        static std::vector<size_t> merge(const std::vector<std::string>& inputs,
+            const std::string& output);
+        // Checksum of the content of a file; false if it cannot be read
+        static bool checksum(const std::string& path, uint64_t& sum);
+
+        inline size_t jobCount() const { return jobs; }
+        inline const std::vector<Entry>& entries() const { return done; }
+
+        class FileException;
+
+    private:
+        std::string file;           // configuration file
+        size_t jobs;                // in the whole run
+        std::string selection;      // jobs assigned to this process
+        std::vector<Entry> done;
+        std::string path;           // of the journal
+        std::ofstream journal;
+        std::map<std::string, Entry> previous;  // by config and index
+        std::mutex mtx;
+
+        void writeHeader(std::ostream& out) const;
+        static void writeEntry(std::ostream& out, const Entry& e);
+        static std::string id(const Entry& e);
+};
+
+class Manifest::FileException : public std::exception {
+    public:
+        FileException(std::string message) : message(message) {}
+        const char* what() { return message.c_str(); }
+    private:
+        std::string message;
+};
+
+#endif
\ No newline at end of file
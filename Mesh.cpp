@@ -1,4 +1,10 @@
 #include "Mesh.hpp"
+#include "AreaSampler.hpp"
+#include "PlyWriter.hpp"
+#include "ChunkedOutput.hpp"
+#include "CompressedStream.hpp"
+#include "EdgeMap.hpp"
+#include "Profiler.hpp"
 
 // Constructor
 Mesh::Mesh(bool nrm, bool par, bool dif) :
@@ -52,6 +58,14 @@ uint Mesh::attToOff(Attribute att) const {
     throw NoAttributeException();
 }
 
+std::vector<std::string> Mesh::attribNames(bool nrm, bool par, bool dif) {
+    std::vector<std::string> names = {"x", "y", "z"};
+    if (nrm) names.insert(names.end(), {"nx", "ny", "nz"});
+    if (par) names.insert(names.end(), {"u", "v"});
+    if (dif) names.insert(names.end(), {"k", "h"});
+    return names;
+}
+
 uint Mesh::addVertex() {
     for (uint i=0; i<attCmp; ++i)
         verts.push_back(0);
@@ -83,6 +97,7 @@ void Mesh::draw(GLuint drawMode) const {
 
 // Prepare for drawing
 void Mesh::finalize(bool nogui) {
+    PROFILE_SCOPE("finalize");
     if (hasNrm && !normalsComputed) computeNormals();
     if (nogui) {
         final = true;
@@ -142,6 +157,7 @@ void Mesh::finalize(bool nogui) {
 
 Mesh::~Mesh() {
     deleteBuffers();
+    delete sampler;
 }
 
 void Mesh::deleteBuffers()  {
@@ -159,15 +175,16 @@ void Mesh::deleteBuffers()  {
 
 
 void Mesh::computeNormals(bool noCompute) {
+    PROFILE_SCOPE("normals");
     if (!hasNrm) throw NoAttributeException();
     normalsComputed = true;
     if (noCompute) return;
 
-    // Compute normals
-    auto normals = new glm::dvec3[vNum];
-
+    // Accumulated in place of the normals
     for (uint i=0; i<vNum; ++i) {
-        normals[i] = glm::dvec3(0);
+        attrib(i, Attribute::NX) = 0;
+        attrib(i, Attribute::NY) = 0;
+        attrib(i, Attribute::NZ) = 0;
     }
 
     // for each face, compute normal
@@ -186,34 +203,37 @@ void Mesh::computeNormals(bool noCompute) {
         // Accumulate unnormalised* normal on each vertex
         // *i.e. weighted by face area
         for (uint j=0; j<3; ++j) {
-            normals[faces[3*i+j]] += n;
+            attrib(faces[3*i+j], Attribute::NX) += n.x;
+            attrib(faces[3*i+j], Attribute::NY) += n.y;
+            attrib(faces[3*i+j], Attribute::NZ) += n.z;
         }
     }
 
-    // for each vertex, normalise the normal and write to the vector
+    // for each vertex, normalise the normal
     for (uint i=0; i<vNum; ++i) {
-        normals[i] = -glm::normalize(normals[i]);
-        attrib(i, Attribute::NX) = normals[i].x;
-        attrib(i, Attribute::NY) = normals[i].y;
-        attrib(i, Attribute::NZ) = normals[i].z;
+        const glm::dvec3 n = -glm::normalize(glm::dvec3(
+            cAttrib(i, Attribute::NX), cAttrib(i, Attribute::NY),
+            cAttrib(i, Attribute::NZ)));
+        attrib(i, Attribute::NX) = n.x;
+        attrib(i, Attribute::NY) = n.y;
+        attrib(i, Attribute::NZ) = n.z;
     }
-
-    delete[] normals;
 }
 
 
 void Mesh::readOBJ(std::string path) {
     // Open file
-    std::ifstream file(path);
+    InFile file(path);
     if (!file.is_open()) throw FileOpenException();
 
     // Get data
+    std::string tok, a, b, c;
     while (!file.eof()) {
-        std::string tok;
+        tok.clear();
         file >> tok;
         // Ignores normals!
         if (tok.length() > 0) {
-            std::string a, b, c;
+            a.clear(); b.clear(); c.clear();
             if (tok == "v") {
                 file >> a >> b >> c;
                 addVertex(std::stof(a), std::stof(b), std::stof(c));
@@ -228,158 +248,175 @@ void Mesh::readOBJ(std::string path) {
 
     // Close file
     file.close();
+
+    // Seams are often stored as duplicated vertices
+    weldVertices();
 }
 
 
 void Mesh::writeOBJ(std::string path) const {
+    PROFILE_SCOPE("writeOBJ");
     if (!final) throw Mesh::NotFinalizedException();
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw FileOpenException();
 
     // Write verts
-    for (uint i=0; i < vNum; ++i) {
-        file << "v "
+    ChunkedOutput::write(file, vNum, [&](std::ostream& out, size_t i) {
+        out << "v "
             << std::setprecision(DPRECIS) << cAttrib(i, Attribute::X) << " "
             << std::setprecision(DPRECIS) << cAttrib(i, Attribute::Y) << " "
             << std::setprecision(DPRECIS) << cAttrib(i, Attribute::Z)
-            << std::endl;
-    }
+            << '\n';
+    });
     // Write normals
     if (hasNrm) {
-        for (uint i=0; i < vNum; ++i) {
-            file << "vn "
+        ChunkedOutput::write(file, vNum, [&](std::ostream& out, size_t i) {
+            out << "vn "
                 << std::setprecision(DPRECIS) << cAttrib(i, Attribute::NX) << " "
                 << std::setprecision(DPRECIS) << cAttrib(i, Attribute::NY) << " "
                 << std::setprecision(DPRECIS) << cAttrib(i, Attribute::NZ)
-                << std::endl;
-        }
+                << '\n';
+        });
     }
     // Write faces
-    for (uint i=0; i < faces.size(); i+=3) {
-        file << "f "
-            << faces[i+0] + 1 << " "
-            << faces[i+1] + 1 << " "
-            << faces[i+2] + 1 << std::endl;
-    }
+    ChunkedOutput::write(file, fNum, [&](std::ostream& out, size_t i) {
+        out << "f "
+            << faces[3*i+0] + 1 << " "
+            << faces[3*i+1] + 1 << " "
+            << faces[3*i+2] + 1 << '\n';
+    });
 
     // Close file
     file.close();
+    if (!file) throw FileWriteException();
 }
 
-void Mesh::writePLY(std::string path) const {
+void Mesh::writePLY(std::string path, bool binary) const {
+    PROFILE_SCOPE("writePLY");
     if (!final) throw Mesh::NotFinalizedException();
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw FileOpenException();
-    
+    PlyWriter ply(file, binary ? PlyWriter::BINARY : PlyWriter::ASCII);
+
     // Header
-    file << "ply" << std::endl << "format ascii 1.0" << std::endl;
-    if (!name.empty()) file << "comment " << name << std::endl;
-    file << "element vertex " << vNum << std::endl;
-    file << "property double x" << std::endl << "property double y" <<
-        std::endl << "property double z" << std::endl;
-    if (hasNrm) file << "property double nx" << std::endl <<
-        "property double ny" << std::endl << "property double nz" <<
-        std::endl;
-    if (hasPar) file << "property double u" << std::endl <<
-        "property double v" << std::endl;
-    if (hasDif) file << "property double k" << std::endl <<
-        "property double h" << std::endl;
-    file << "element face " << fNum << std::endl;
-    file << "property list uchar int vertex_indices" << std::endl;
-    file << "end_header" << std::endl;
+    if (!name.empty()) ply.comment(name);
+    ply.element("vertex", vNum);
+    for (const std::string& att : attribNames()) ply.property(att);
+    ply.element("face", fNum);
+    ply.listProperty("vertex_indices");
+    ply.endHeader();
 
     // Write vertices
-    for (uint i=0; i < verts.size(); i+=attCmp) {
-        for (uint j=0; j<attCmp; ++j) {
-            file << std::setprecision(DPRECIS) << verts[i+j] << " ";
-        }
-        file << std::endl;
-    }
+    ChunkedOutput::write(file, vNum, [&](std::ostream& out, size_t i) {
+        PlyWriter row = ply.rows(out);
+        for (uint j=0; j<attCmp; ++j) row.value(verts[attCmp*i+j]);
+        row.endRow();
+    });
 
     // Write faces
-    for (uint i=0; i < faces.size(); i+=3) {
-        file << "3 ";
-        for (uint j=0; j<3; ++j) {
-            file << faces[i+j] << " ";
-        }
-        file << std::endl;
-    }
+    ChunkedOutput::write(file, fNum, [&](std::ostream& out, size_t i) {
+        PlyWriter row = ply.rows(out);
+        row.list(&faces[3*i], 3);
+        row.endRow();
+    });
     
     // Close file
     file.close();
+    if (!file) throw FileWriteException();
 }
 
 void Mesh::writeOFF(std::string path) const {
+    PROFILE_SCOPE("writeOFF");
     if (!final) throw Mesh::NotFinalizedException();
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw FileOpenException();
 
     // Header
     file << "OFF " << vNum << " " << fNum << " " << 0 << std::endl;
 
     // Write verts
-    for (uint i=0; i < vNum; ++i) {
-        file << std::setprecision(DPRECIS) << cAttrib(i, Attribute::X) << " "
+    ChunkedOutput::write(file, vNum, [&](std::ostream& out, size_t i) {
+        out << std::setprecision(DPRECIS) << cAttrib(i, Attribute::X) << " "
             << std::setprecision(DPRECIS) << cAttrib(i, Attribute::Y) << " "
-            << std::setprecision(DPRECIS) << cAttrib(i, Attribute::Z) << std::endl;
-    }
+            << std::setprecision(DPRECIS) << cAttrib(i, Attribute::Z) << '\n';
+    });
     // Write faces
-    for (uint i=0; i < faces.size(); i+=3) {
-        file << "3 "
-            << faces[i+0] << " "
-            << faces[i+1] << " "
-            << faces[i+2] << std::endl;
-    }
+    ChunkedOutput::write(file, fNum, [&](std::ostream& out, size_t i) {
+        out << "3 "
+            << faces[3*i+0] << " "
+            << faces[3*i+1] << " "
+            << faces[3*i+2] << '\n';
+    });
 
     // Close file
     file.close();
+    if (!file) throw FileWriteException();
 }
 
 
 void Mesh::gaussNoise(double variance, bool nrm, bool tan) {
+    PROFILE_SCOPE("noise");
     if (!(nrm || tan)) return;
-    for (uint i = 0; i < vNum; ++i) {
-        glm::dvec3 noise(0);
-        if (nrm && tan) {
-            noise = RandPoint::gaussian3(variance);
-        }
-        else {
-            if (!normalsComputed) computeNormals();
-            glm::dvec3 normalVec(
-                cAttrib(i, Attribute::NX),
-                cAttrib(i, Attribute::NY),
-                cAttrib(i, Attribute::NZ)
-            );
-            normalVec = glm::normalize(normalVec);
-            if (tan) {
-                // Construct a basis for the tangent space
-                glm::dvec3 v1, v2;
-                if (normalVec.z != 0) {
-                    v1 = glm::dvec3(1, 1, 
-                        -(normalVec.x + normalVec.y)/normalVec.z);
-                    v1 = glm::normalize(v1);
+    if (!(nrm && tan) && !normalsComputed) computeNormals();
+    // Gaussians per vertex: 3 in space, 2 in the tangent plane, 1 along
+    // the normal
+    const uint dims = (nrm && tan) ? 3 : (tan ? 2 : 1);
+    // Noise is generated in chunks small enough to stay in cache, then
+    // applied; element k of the batch is fixed by the key, so the result
+    // does not depend on the schedule
+    const uint64_t key = RandPoint::current().split();
+    const uint chunk = 1 << 12;
+    #pragma omp parallel
+    {
+        std::vector<double> noise(dims * chunk);
+        #pragma omp for schedule(dynamic)
+        for (uint c = 0; c < vNum; c += chunk) {
+            const uint n = std::min(chunk, vNum - c);
+            RandPoint::gaussians(key, size_t(dims) * c, dims * n, variance,
+                noise.data());
+            for (uint k = 0; k < n; ++k) {
+                const uint i = c + k;
+                const double* g = &noise[dims * k];
+                glm::dvec3 offset;
+                if (dims == 3) {
+                    offset = glm::dvec3(g[0], g[1], g[2]);
                 }
-                else v1 = glm::dvec3(0,0,1);
-                v2 = glm::cross(normalVec, v1);
-                v2 = glm::normalize(v2);
-                const auto n = RandPoint::gaussian2(variance);
-                noise = v1 * n.s + v2 * n.t;
-            }
-            if (nrm) {
-                noise = normalVec * RandPoint::gaussian1(variance);
+                else {
+                    glm::dvec3 normalVec(
+                        cAttrib(i, Attribute::NX),
+                        cAttrib(i, Attribute::NY),
+                        cAttrib(i, Attribute::NZ)
+                    );
+                    normalVec = glm::normalize(normalVec);
+                    if (dims == 2) {
+                        // Construct a basis for the tangent space
+                        glm::dvec3 v1, v2;
+                        if (normalVec.z != 0) {
+                            v1 = glm::dvec3(1, 1, 
+                                -(normalVec.x + normalVec.y)/normalVec.z);
+                            v1 = glm::normalize(v1);
+                        }
+                        else v1 = glm::dvec3(0,0,1);
+                        v2 = glm::cross(normalVec, v1);
+                        v2 = glm::normalize(v2);
+                        offset = v1 * g[0] + v2 * g[1];
+                    }
+                    else offset = normalVec * g[0];
+                }
+
+                attrib(i, Attribute::X) += offset.x;
+                attrib(i, Attribute::Y) += offset.y;
+                attrib(i, Attribute::Z) += offset.z;
             }
         }
-
-        attrib(i, Attribute::X) += noise.x;
-        attrib(i, Attribute::Y) += noise.y;
-        attrib(i, Attribute::Z) += noise.z;
     }
 }
 
 void Mesh::makeCentered() {
+    PROFILE_SCOPE("center");
     double com[3];
     for (uint k = 0; k < 3; ++k) com[k] = 0;
     // Accumulate
@@ -400,11 +437,9 @@ void Mesh::makeCentered() {
 
 
 void Mesh::refine() {
-    typedef unsigned long long int Edge;
     // Save edge and position within vertex list
-    std::unordered_map<Edge, unsigned long int> edges;
     const unsigned long int oldFNum = fNum, oldVNum = vNum;
-    edges.reserve(oldFNum * 3 / 2);
+    EdgeMap<uint> edges(oldFNum * 3 / 2);
     for (unsigned long int fi = 0; fi < oldFNum; ++fi) {
         unsigned long int viOld[3], viNew[3];    // indices
         for (unsigned long int k = 0; k < 3; ++k) {
@@ -414,10 +449,10 @@ void Mesh::refine() {
         for (unsigned long int k = 0; k < 3; ++k) {
             // Indices of edge's endpoints
             const unsigned long int a = viOld[k], b = viOld[(k+1)%3];
-            const Edge e = std::max(a,b) + oldVNum * std::min(a,b);
+            const uint64_t e = std::max(a,b) + oldVNum * std::min(a,b);
             // If already present
-            if (edges.count(e) == 1) {
-                viNew[k] = edges.at(e);
+            if (const uint* v = edges.find(e)) {
+                viNew[k] = *v;
             }
             else {
                 // Make new vertex
@@ -427,7 +462,7 @@ void Mesh::refine() {
                     attrib(viNew[k], att) = (cAttrib(viOld[k], att) + 
                         cAttrib(viOld[(k+1)%3], att)) / 2;
                 }
-                edges.emplace(e, viNew[k]);                 // cache
+                edges[e] = viNew[k];                        // cache
             }
         }
 
@@ -443,6 +478,132 @@ void Mesh::refine() {
 }
 
 
+std::vector<uint> Mesh::weldMap(const double* coords, uint n, uint stride,
+    uint dims, double tolerance, const double* period) {
+    // Hash grid with cells of the tolerance's size; a periodic coordinate
+    // has a whole number of cells per period
+    const double h = std::max(tolerance, 1e-300);
+    long long cells[3] = {0, 0, 0};
+    for (uint d = 0; d < dims; ++d) {
+        if (period && period[d] > 0)
+            cells[d] = std::max(1., std::floor(period[d] / h));
+    }
+    const auto coordinate = [&](uint i, uint d) {
+        double x = coords[size_t(i) * stride + d];
+        if (cells[d]) x -= std::floor(x / period[d]) * period[d];
+        return x;
+    };
+    const auto cellOf = [&](uint i, uint d) {
+        long long c = std::floor(coordinate(i, d) / h);
+        if (cells[d]) c = std::min(c, cells[d] - 1);
+        return c;
+    };
+    const auto hash = [&](const long long* c) {
+        uint64_t k = 0;
+        for (uint d = 0; d < dims; ++d)
+            k = (k ^ static_cast<uint64_t>(c[d])) * 0x9E3779B97F4A7C15ull;
+        return k;
+    };
+
+    // Bucket points by cell
+    std::vector<uint64_t> key(n);
+    #pragma omp parallel for
+    for (uint i = 0; i < n; ++i) {
+        long long c[3];
+        for (uint d = 0; d < dims; ++d) c[d] = cellOf(i, d);
+        key[i] = hash(c);
+    }
+    // Buckets are the runs of points sorted by cell
+    std::vector<std::pair<uint64_t, uint>> sorted(n);
+    for (uint i = 0; i < n; ++i) sorted[i] = std::make_pair(key[i], i);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<uint64_t> bucketKey;
+    std::vector<uint> start, members(n);
+    for (uint i = 0; i < n; ++i) {
+        if (i == 0 || sorted[i].first != sorted[i-1].first) {
+            bucketKey.push_back(sorted[i].first);
+            start.push_back(i);
+        }
+        members[i] = sorted[i].second;
+    }
+    start.push_back(n);
+
+    // Smallest matching index among the neighboring cells
+    std::vector<uint> rep(n);
+    uint neighbors = 1;
+    for (uint d = 0; d < dims; ++d) neighbors *= 3;
+    #pragma omp parallel for
+    for (uint i = 0; i < n; ++i) {
+        rep[i] = i;
+        long long c[3];
+        for (uint d = 0; d < dims; ++d) c[d] = cellOf(i, d);
+        for (uint nb = 0; nb < neighbors; ++nb) {
+            long long cn[3];
+            for (uint d = 0, r = nb; d < dims; ++d, r /= 3) {
+                cn[d] = c[d] + static_cast<long long>(r % 3) - 1;
+                if (cells[d]) cn[d] = (cn[d] + cells[d]) % cells[d];
+            }
+            const uint64_t k = hash(cn);
+            const auto it = std::lower_bound(bucketKey.begin(),
+                bucketKey.end(), k);
+            if (it == bucketKey.end() || *it != k) continue;
+            const uint b = it - bucketKey.begin();
+            for (uint m = start[b]; m < start[b+1]; ++m) {
+                const uint j = members[m];
+                if (j >= rep[i]) continue;
+                bool match = true;
+                for (uint d = 0; d < dims && match; ++d) {
+                    double dx = std::abs(coordinate(i, d) - coordinate(j, d));
+                    if (cells[d]) dx = std::min(dx, period[d] - dx);
+                    match = (dx <= tolerance);
+                }
+                if (match) rep[i] = j;
+            }
+        }
+    }
+    // Follow chains, so that every group has a single representative
+    for (uint i = 0; i < n; ++i) rep[i] = rep[rep[i]];
+    return rep;
+}
+
+std::vector<uint> Mesh::weldVertices(double tolerance) {
+    const std::vector<uint> rep = weldMap(verts.data(), vNum, attCmp, 3,
+        tolerance);
+    // Compact the vertices, keeping the first of each group
+    std::vector<uint> newId(vNum);
+    uint kept = 0;
+    for (uint i = 0; i < vNum; ++i) {
+        if (rep[i] != i) {
+            newId[i] = newId[rep[i]];
+            continue;
+        }
+        newId[i] = kept;
+        if (kept != i) {
+            std::copy(verts.begin() + size_t(i) * attCmp,
+                verts.begin() + size_t(i + 1) * attCmp,
+                verts.begin() + size_t(kept) * attCmp);
+        }
+        ++kept;
+    }
+    vNum = kept;
+    verts.resize(size_t(vNum) * attCmp);
+    // Remap faces and drop collapsed ones
+    uint f = 0;
+    for (uint i = 0; i < fNum; ++i) {
+        const uint a = newId[faces[3*i]], b = newId[faces[3*i+1]],
+            c = newId[faces[3*i+2]];
+        if (a == b || b == c || c == a) continue;
+        faces[3*f] = a;
+        faces[3*f+1] = b;
+        faces[3*f+2] = c;
+        ++f;
+    }
+    fNum = f;
+    faces.resize(size_t(fNum) * 3);
+    return newId;
+}
+
+
 // cache this
 double Mesh::getAverageEdgeLength() const {
     double len = 0;
@@ -508,70 +669,12 @@ double Mesh::getArea(uint faceId) const {
 
 
 glm::dvec2 Mesh::randomPointUV() {
-    // Compute CDF if necessary
-    if (faceCDF.size() == 0) {
-        double sum = 0;
-        faceCDF.reserve(faceNum());
-        for (uint i = 0; i < faceNum(); ++i) {
-            sum += getArea(i);
-            faceCDF.push_back(sum);
-        }
-    }
-    const double r = glm::linearRand(0., faceCDF.back());
-    uint randomFace = 0;
-    while (r > faceCDF.at(randomFace)) ++randomFace; // TODO: binary search
-    // Get face
-    glm::dvec2 v[3];
-    for (uint j=0; j<3; ++j) {
-        v[j].x = cAttrib(cFacei(randomFace,j), Attribute::U);
-        v[j].y = cAttrib(cFacei(randomFace,j), Attribute::V);
-        // Check if the triangle overlaps the border of the uv plane
-        // Very reasonable assumption: no triangle spans more than 
-        // half the plane in U or V direction
-        const double lmax = .25, rmin = .75;
-        // If there are any points on the far right...
-        if (v[0].x > rmin || v[1].x > rmin || v[2].x > rmin) {
-            // Check which points lie on the far left and "unwrap" them
-            for (uint k = 0; k < 3; ++k) {
-                if (v[k].x < lmax) v[k].x += 1;
-            }
-        }
-        // Same for the y
-        if (v[0].y > rmin || v[1].y > rmin || v[2].y > rmin) {
-            for (uint k = 0; k < 3; ++k) {
-                if (v[k].y < lmax) v[k].y += 1;
-            }
-        }
-    }
-    auto rnd = RandPoint::inTriangle(v[0], v[1], v[2]);
-    // Wrap back the coordinates for triangles over the border
-    if (rnd.x > 1) rnd.x -= 1;
-    if (rnd.y > 1) rnd.y -= 1;
-    return rnd;
+    if (!sampler) sampler = new AreaSampler(*this);
+    return sampler->sampleUV();
 }
 
 std::vector<glm::dvec2> Mesh::uniformSampling(uint samples, bool corners,
-    uint border) {
-    std::vector<glm::dvec2> newVerts;
-    newVerts.reserve(samples);
-    // Add corner vertices first
-    if (corners) {
-        newVerts.push_back(glm::dvec2(0,0));
-        newVerts.push_back(glm::dvec2(1,0));
-        newVerts.push_back(glm::dvec2(1,1));
-        newVerts.push_back(glm::dvec2(0,1));
-    }
-    // Then, add border vertices (in groups of 4)
-    const uint start = newVerts.size();
-    for (uint i = newVerts.size(); i < border; i+=4) {
-        const auto rand = randomPointUV();
-        newVerts.push_back(glm::dvec2(rand.x,0));
-        newVerts.push_back(glm::dvec2(1,rand.y));
-        newVerts.push_back(glm::dvec2(rand.x,1));
-        newVerts.push_back(glm::dvec2(0,rand.y));
-    }
-    // Finally, add inner vertices
-    for (uint i = newVerts.size(); i < samples; ++i)
-        newVerts.push_back(randomPointUV());
-    return newVerts;
+    uint border, const LowDiscrepancy* sequence) {
+    if (!sampler) sampler = new AreaSampler(*this);
+    return sampler->uniformSampling(samples, corners, border, sequence);
 }
\ No newline at end of file
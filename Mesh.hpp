@@ -10,9 +10,13 @@
 
 #include "RandPoint.hpp"
 #include "DifferentialQuantities.hpp"
+#include "Constants.hpp"
 
 const size_t DPRECIS = std::numeric_limits<double>::digits10 + 1;
 
+class UVSampler;
+class LowDiscrepancy;
+
 
 class Mesh { 
     public:
@@ -29,6 +33,12 @@ class Mesh {
         // Get vertex and face number
         const inline uint vertNum() const { return vNum; }
         const inline uint faceNum() const { return fNum; }
+        // Memory held by vertex and face data
+        const inline size_t byteSize() const {
+            return verts.capacity() * sizeof(double) +
+                faces.capacity() * sizeof(uint);
+        }
+        const inline bool hasGLBuffers() const { return allocatedGLBuffers; }
 
         // Core methods
         void reserveSpace(uint verts, uint faces);
@@ -42,7 +52,7 @@ class Mesh {
         void readOBJ(std::string filename);
 
         // File output
-        void writePLY(std::string filename) const;
+        void writePLY(std::string filename, bool binary = false) const;
         void writeOBJ(std::string filename) const;
         void writeOFF(std::string filename) const;
 
@@ -59,6 +69,13 @@ class Mesh {
         const inline uint cFacei(uint faceId, uint n) const {
             return faces[3 * faceId + n];
         }
+        // Per-vertex attribute components, in storage order
+        const inline uint attribComponents() const { return attCmp; }
+        std::vector<std::string> attribNames() const {
+            return attribNames(hasNrm, hasPar, hasDif);
+        }
+        static std::vector<std::string> attribNames(bool normals,
+            bool parametric, bool curvature);
 
         // Utility methods
         double getAverageEdgeLength() const;
@@ -92,12 +109,24 @@ class Mesh {
             bool normal = true, bool tangential = true);
         void makeCentered();
         void refine();
+        // Merge vertices closer than the tolerance in space, dropping the
+        // faces that collapse; returns the new index of each old vertex
+        std::vector<uint> weldVertices(double tolerance = WELD_TOLERANCE);
+        // Representative (smallest matching index) of each of n points of
+        // dims coordinates, stride apart, where points match if every
+        // coordinate is within the tolerance. A nonzero period makes a
+        // coordinate wrap around.
+        static std::vector<uint> weldMap(const double* coords, uint n,
+            uint stride, uint dims, double tolerance,
+            const double* period = nullptr);
 
         glm::dvec2 randomPointUV();
         std::vector<glm::dvec2> uniformSampling(
-            uint numSamples, bool corners = true, uint border = 0);
+            uint numSamples, bool corners = true, uint border = 0,
+            const LowDiscrepancy* sequence = nullptr);
 
         class FileOpenException;
+        class FileWriteException;
         class NotFinalizedException;
         class NoAttributeException;
 
@@ -124,7 +153,7 @@ class Mesh {
         vArray verts;
         fArray faces;
 
-        std::vector<double> faceCDF;
+        UVSampler* sampler = nullptr;   // built on first random sample
 
         GLuint vbo, ebo, vao;   // Buffer indices
         const uint attCnt; // Attribute count
@@ -149,6 +178,10 @@ class Mesh::FileOpenException : public std::exception {
     public: const char* what() { return "Could not open file"; }
 };
 
+class Mesh::FileWriteException : public std::exception {
+    public: const char* what() { return "Could not write file"; }
+};
+
 class Mesh::NotFinalizedException : public std::exception {
     public: const char* what() { return "Mesh has not been finalised"; }
 };
@@ -0,0 +1,43 @@
+#include "MeshStream.hpp"
+#include "Mesh.hpp"
+
+MeshStream::MeshStream(std::string path, std::string name, uint vertices,
+    uint faces, PlyWriter::Format format) :
+    file(path), vNum(vertices), fNum(faces) {
+    // Open file
+    if (!file.is_open()) throw Mesh::FileOpenException();
+
+    ply = new PlyWriter(file, format);
+
+    // Header
+    if (!name.empty()) ply->comment(name);
+    ply->element("vertex", vNum);
+    for (const std::string& att : Mesh::attribNames(true, true, true))
+        ply->property(att);
+    ply->element("face", fNum);
+    ply->listProperty("vertex_indices");
+    ply->endHeader();
+}
+
+MeshStream::~MeshStream() {
+    delete ply;
+}
+
+void MeshStream::vertex(const double* attrib) {
+    if (vCnt++ == vNum) throw CountMismatchException();
+    for (uint j = 0; j < attributes; ++j) ply->value(attrib[j]);
+    ply->endRow();
+}
+
+void MeshStream::face(uint i, uint j, uint k) {
+    if (vCnt != vNum || fCnt++ == fNum) throw CountMismatchException();
+    const uint f[3] = {i, j, k};
+    ply->list(f, 3);
+    ply->endRow();
+}
+
+void MeshStream::close() {
+    if (vCnt != vNum || fCnt != fNum) throw CountMismatchException();
+    file.close();
+    if (!file) throw Mesh::FileWriteException();
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef MESHSTREAM_H
+#define MESHSTREAM_H
+
+#include "CompressedStream.hpp"
+#include "PlyWriter.hpp"
+
+// Writes a mesh with every vertex attribute (position, normal, uv, k, h)
+// to a PLY file as it is generated, without keeping it in memory.
+// Vertex and face counts must be known in advance; all vertices are emitted
+// before any face.
+class MeshStream {
+    public:
+        static const uint attributes = 10;
+
+        MeshStream(std::string path, std::string name, uint vertices,
+            uint faces, PlyWriter::Format format = PlyWriter::BINARY);
+        ~MeshStream();
+
+        void vertex(const double* attrib);
+        void face(uint i, uint j, uint k);
+        void close();
+
+        class CountMismatchException;
+
+    private:
+        OutFile file;
+        PlyWriter* ply = nullptr;
+        const uint vNum, fNum;
+        uint vCnt = 0, fCnt = 0;
+};
+
+class MeshStream::CountMismatchException : public std::exception {
+    public: const char* what() { return "Streamed element count mismatch"; }
+};
+
+#endif
\ No newline at end of file
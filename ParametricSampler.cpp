@@ -0,0 +1,134 @@
+#include "ParametricSampler.hpp"
+#include <algorithm>
+#include <cmath>
+
+ParametricSampler::ParametricSampler(Density density, uint resolution) :
+    density(density), res(resolution) {
+    tabulate();
+}
+
+ParametricSampler::ParametricSampler(const Mesh& mesh, uint resolution) :
+    density([&mesh](double u, double v) {
+        return mesh.diffEvaluate(u, v).areaElement();
+    }), res(resolution) {
+    tabulate();
+}
+
+void ParametricSampler::tabulate() {
+    // Density on a grid at half cell spacing (corners, edge midpoints and
+    // centers of the cells), and at the centers of the quarter cells
+    const uint n = 2 * res + 1;
+    const double g = 1. / (n - 1);     // grid spacing
+    std::vector<double> d(n * n), q((n - 1) * (n - 1));
+    #pragma omp parallel for
+    for (uint j = 0; j < n; ++j) {
+        for (uint i = 0; i < n; ++i) {
+            d[j * n + i] = std::max(0., density(i * g, j * g));
+            if (i + 1 < n && j + 1 < n) {
+                q[j * (n - 1) + i] = std::max(0., density((i + .5) * g,
+                    (j + .5) * g));
+            }
+        }
+    }
+
+    // Per-cell maximum, steepest slope between neighboring points, and
+    // mean (Simpson's rule on the 3x3 points)
+    const double w[3] = {1, 4, 1};
+    std::vector<double> mx(res * res, 0), slope(res * res, 0);
+    std::vector<double> mean(res * res, 0);
+    for (uint j = 0; j < res; ++j) {
+        for (uint i = 0; i < res; ++i) {
+            const uint c = j * res + i;
+            double sum = 0;
+            for (uint b = 0; b < 3; ++b) {
+                for (uint a = 0; a < 3; ++a) {
+                    const double x = d[(2*j + b) * n + 2*i + a];
+                    mx[c] = std::max(mx[c], x);
+                    sum += w[a] * w[b] * x;
+                    if (a < 2) slope[c] = std::max(slope[c],
+                        std::abs(d[(2*j + b) * n + 2*i + a + 1] - x) / g);
+                    if (b < 2) slope[c] = std::max(slope[c],
+                        std::abs(d[(2*j + b + 1) * n + 2*i + a] - x) / g);
+                }
+            }
+            // Quarter cell centers, half a diagonal from their corners
+            for (uint b = 0; b < 2; ++b) {
+                for (uint a = 0; a < 2; ++a) {
+                    const double x = q[(2*j + b) * (n - 1) + 2*i + a];
+                    mx[c] = std::max(mx[c], x);
+                    for (uint k = 0; k < 4; ++k) {
+                        const double y = d[(2*j + b + k/2) * n + 2*i + a +
+                            k%2];
+                        slope[c] = std::max(slope[c],
+                            std::abs(y - x) * M_SQRT2 / g);
+                    }
+                }
+            }
+            mean[c] = sum / 36;
+        }
+    }
+
+    // Every point of a cell is within g / 2 of a tabulated point, so its
+    // density exceeds their maximum by at most that times the gradient.
+    // The gradient is taken as twice the steepest slope seen in the cell
+    // and its neighbors, so that cells whose points are all zero are still
+    // drawn next to a positive density. Features narrower than the grid
+    // spacing may be missed entirely, so the resolution must resolve them.
+    bound.assign(res * res, 0);
+    for (uint j = 0; j < res; ++j) {
+        for (uint i = 0; i < res; ++i) {
+            double steepest = 0;
+            for (uint b = (j > 0 ? j - 1 : 0); b <= std::min(j + 1, res - 1);
+                ++b) {
+                for (uint a = (i > 0 ? i - 1 : 0);
+                    a <= std::min(i + 1, res - 1); ++a) {
+                    steepest = std::max(steepest, slope[b * res + a]);
+                }
+            }
+            bound[j * res + i] = mx[j * res + i] + 2 * steepest * g / 2;
+        }
+    }
+    cells = AliasTable(bound);
+
+    // Cumulative distributions for warp
+    rowCDF.assign(res + 1, 0);
+    cellCDF.assign(res * (res + 1), 0);
+    for (uint j = 0; j < res; ++j) {
+        double* row = &cellCDF[j * (res + 1)];
+        for (uint i = 0; i < res; ++i) row[i+1] = row[i] + mean[j * res + i];
+        rowCDF[j+1] = rowCDF[j] + row[res];
+    }
+}
+
+glm::dvec2 ParametricSampler::sampleUV(RandPoint::Stream& rng) const {
+    while (true) {
+        const uint c = cells.sample(rng.uniform());
+        const double u = (c % res + rng.uniform()) / res;
+        const double v = (c / res + rng.uniform()) / res;
+        if (rng.uniform() * bound[c] <= density(u, v)) {
+            return glm::dvec2(u, v);
+        }
+    }
+}
+
+namespace {
+    // Cell of a cumulative distribution of n cells, and the position in it
+    double invert(const double* cdf, uint n, double p, uint& cell) {
+        const double x = p * cdf[n];
+        cell = std::upper_bound(cdf + 1, cdf + n, x) - cdf - 1;
+        const double width = cdf[cell+1] - cdf[cell];
+        return (width > 0) ? (x - cdf[cell]) / width : .5;
+    }
+}
+
+glm::dvec2 ParametricSampler::warp(glm::dvec2 p) const {
+    uint i, j;
+    const double fv = invert(rowCDF.data(), res, p.y, j);
+    const double fu = invert(&cellCDF[j * (res + 1)], res, p.x, i);
+    return glm::dvec2((i + fu) / res, (j + fv) / res);
+}
+
+size_t ParametricSampler::byteSize() const {
+    return (bound.capacity() + rowCDF.capacity() + cellCDF.capacity()) *
+        sizeof(double) + cells.byteSize();
+}
\ No newline at end of file
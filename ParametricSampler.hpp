@@ -0,0 +1,42 @@
+#ifndef PARAMETRICSAMPLER_H
+#define PARAMETRICSAMPLER_H
+
+#include <functional>
+#include "Mesh.hpp"
+#include "AliasTable.hpp"
+#include "UVSampler.hpp"
+
+// Sampling of the parametric square with density proportional to a function
+// of (u,v), by default the area element sqrt(det g) of the surface. The
+// density is tabulated on a grid: cells are drawn through an alias table of
+// per-cell upper bounds (the tabulated maximum plus a margin from the
+// steepest tabulated slope around the cell), then points are accepted or
+// rejected against the exact density. No proxy mesh is involved.
+class ParametricSampler : public UVSampler {
+    public:
+        typedef std::function<double(double, double)> Density;
+
+        ParametricSampler(Density density, uint resolution = 64);
+        // Area element of any mesh which implements diffEvaluate
+        ParametricSampler(const Mesh& mesh, uint resolution = 64);
+
+        using UVSampler::sampleUV;
+        glm::dvec2 sampleUV(RandPoint::Stream& rng = RandPoint::current())
+            const override;
+        // Inverse CDF of the tabulated density (piecewise constant on the
+        // grid): maps uniform points of the unit square to the domain
+        glm::dvec2 warp(glm::dvec2 p) const override;
+
+        size_t byteSize() const override;
+
+    private:
+        void tabulate();
+        const Density density;
+        const uint res;
+        std::vector<double> bound;      // density bound per cell
+        std::vector<double> rowCDF;     // marginal in v, res+1 entries
+        std::vector<double> cellCDF;    // conditional in u, res+1 per row
+        AliasTable cells;
+};
+
+#endif
\ No newline at end of file
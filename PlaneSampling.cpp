@@ -1,11 +1,18 @@
 #include "PlaneSampling.hpp"
+#include "CompressedStream.hpp"
+#include "Delaunay.hpp"
+#include "StripTriangulation.hpp"
+#include "TriangulationCache.hpp"
+#include "EdgeMap.hpp"
+#include "Profiler.hpp"
 
 PlaneSampling::PlaneSampling(std::string path) {
+    PROFILE_SCOPE("readPlane");
     verts.clear();
     faces.clear();
 	verts.reserve(32);
 	faces.reserve(64);
-    std::ifstream file(path);
+    InFile file(path);
     if (file.is_open()) {
         uint cnt = 0;
 
@@ -42,7 +49,7 @@ PlaneSampling::PlaneSampling(std::string path) {
 
 void PlaneSampling::print(std::string path) {
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
 
     // Header
     file << "OFF " << vertNum() << " " << faceNum() << " " << 0 << std::endl;
@@ -53,7 +60,7 @@ void PlaneSampling::print(std::string path) {
             << cAttrib(i, Mesh::Attribute::X) << " "
             << std::setprecision(DPRECIS)
             << cAttrib(i, Mesh::Attribute::Y) << " "
-            << 0 << std::endl;
+            << 0 << '\n';
     }
     // Write faces
     for (uint i=0; i < faceNum(); ++i) {
@@ -65,58 +72,203 @@ void PlaneSampling::print(std::string path) {
         file << "3 "
             << cFacei(i,0) << " "
             << cFacei(i,1) << " "
-            << cFacei(i,2) << std::endl;
+            << cFacei(i,2) << '\n';
     }
 
     // Close file
     file.close();
+    if (!file) throw Mesh::FileWriteException();
 }
 
-PlaneSampling::PlaneSampling(std::vector<glm::dvec2> positions) {
+namespace {
+    // Delaunay triangulation by Triangle
+    std::vector<uint> triangleFaces(const std::vector<glm::dvec2>& positions) {
+        // Data structures to call Triangle
+        // moderate amounts of C ahead!
+        triangulateio in, out;
+        std::string triangleFlags = "zBPOQ";
+
+        in.numberofpoints = positions.size();
+        in.numberofpointattributes = 0;
+        in.pointmarkerlist = (int*) NULL;
+        in.pointlist = (double*) malloc(in.numberofpoints*2*sizeof(double));
+        for (uint i = 0; i < in.numberofpoints; ++i) {
+            const auto v = positions.at(i);
+            in.pointlist[2*i+0] = v.x;
+            in.pointlist[2*i+1] = v.y;
+        }
+
+        out.pointlist = (REAL*) NULL;
+        out.trianglelist = (int*) NULL;
+
+        // Triangle wants a writable, terminated string
+        std::vector<char> c(triangleFlags.begin(), triangleFlags.end());
+        c.push_back('\0');
+        triangulate(c.data(), &in, &out, NULL);
+
+        // Points come out as they went in
+        std::vector<uint> faces(out.trianglelist,
+            out.trianglelist + 3 * out.numberoftriangles);
+
+        free(in.pointlist);
+        free(out.pointlist);
+        free(out.trianglelist);
+        return faces;
+    }
+}
+
+PlaneSampling::PlaneSampling(std::vector<glm::dvec2> positions,
+    Periodicity periodicity, const std::string& cacheFolder) :
+    periodicity(periodicity) {
+    PROFILE_SCOPE("triangulate");
     // Plane sampling data structures
     verts.clear();
     faces.clear();
 
-    // Data structures to call Triangle
-    // moderate amounts of C ahead!
-    triangulateio in, out;
-    std::string triangleFlags = "zBPOQ";
-    
-    in.numberofpoints = positions.size();
-    in.numberofpointattributes = 0;
-    in.pointmarkerlist = (int*) NULL;
-    in.pointlist = (double*) malloc(in.numberofpoints*2*sizeof(double));
-    for (uint i = 0; i < in.numberofpoints; ++i) {
-        const auto v = positions.at(i);
-        in.pointlist[2*i+0] = v.x;
-        in.pointlist[2*i+1] = v.y;
+    const bool periodicU = (periodicity != SQUARE);
+    const bool periodicV = (periodicity == TORUS);
+    verts.reserve(positions.size() * 2);
+    for (auto& v : positions) {
+        if (periodicU) v.x -= std::floor(v.x);
+        if (periodicV) v.y -= std::floor(v.y);
+        verts.push_back(v.x);
+        verts.push_back(v.y);
+    }
+    // Points seen before are not triangulated again
+    const TriangulationCache::Key key = TriangulationCache::key(positions,
+        periodicU ? (periodicV ? "delaunay torus" : "delaunay cylinder") :
+        "triangle zBPOQ");
+    std::vector<uint> f;
+    if (!TriangulationCache::find(key, f, cacheFolder)) {
+        // Large point sets are triangulated in parallel strips
+        f = periodicU ?
+            Delaunay::triangulate(positions, periodicU, periodicV) :
+            StripTriangulation::triangulate(positions, triangleFaces);
+        TriangulationCache::store(key, f, cacheFolder);
     }
+    faces.assign(f.begin(), f.end());
+}
 
-    out.pointlist = (REAL*) NULL;
-    out.trianglelist = (int*) NULL;
-
-    char * c = (char*)malloc(triangleFlags.size() * sizeof(char));
-    triangleFlags.copy(c, triangleFlags.size());
-    triangulate(c, &in, &out, NULL);
-    free(c);
-
-    // Write triangulation
-    size_t nv = out.numberofpoints;
-    size_t nf = out.numberoftriangles;
-    verts.reserve(nv * 2);
-    faces.reserve(nf * 3);
-    for (uint i = 0; i < nv; ++i) {
-        verts.push_back(out.pointlist[2 * i + 0]);
-        verts.push_back(out.pointlist[2 * i + 1]);
+namespace {
+    inline uint64_t edgeKey(uint a, uint b) {
+        return (a < b) ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
     }
-    for (uint i = 0; i < nf; ++i) {
-        faces.push_back(out.trianglelist[3 * i + 0]);
-        faces.push_back(out.trianglelist[3 * i + 1]);
-        faces.push_back(out.trianglelist[3 * i + 2]);
+
+    inline double orient(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c) {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
     }
-    print("triangulatedPlane.off");
 
-    free(in.pointlist);
-    free(out.pointlist);
-    free(out.trianglelist);
+    // d strictly inside the circle through the counterclockwise a, b, c
+    inline bool inCircle(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c,
+        glm::dvec2 d) {
+        const glm::dvec2 ad = a - d, bd = b - d, cd = c - d;
+        const double det =
+            glm::dot(ad, ad) * (bd.x * cd.y - cd.x * bd.y) -
+            glm::dot(bd, bd) * (ad.x * cd.y - cd.x * ad.y) +
+            glm::dot(cd, cd) * (ad.x * bd.y - bd.x * ad.y);
+        return det > 1e-14;
+    }
+}
+
+uint PlaneSampling::flip(
+    const std::function<glm::dmat2(double, double)>& metric) {
+    PROFILE_SCOPE("flip");
+    const auto point = [this](uint i) {
+        return glm::dvec2(cAttrib(i, 0), cAttrib(i, 1));
+    };
+    // Copy of p nearest to ref, across the periodic seams
+    const bool periodic[2] = {periodicity != SQUARE, periodicity == TORUS};
+    const auto near = [&periodic](glm::dvec2 p, glm::dvec2 ref) {
+        for (uint k = 0; k < 2; ++k)
+            if (periodic[k]) p[k] += std::round(ref[k] - p[k]);
+        return p;
+    };
+    // Faces on each side of every edge, and whether the edge is queued
+    const uint none = -1;
+    struct Edge {
+        uint first, second;
+        bool queued;
+    };
+    EdgeMap<Edge> edges(faceNum() * 2);
+    for (uint f = 0; f < faceNum(); ++f) {
+        for (uint k = 0; k < 3; ++k) {
+            const uint64_t key = edgeKey(cFacei(f, k), cFacei(f, (k+1)%3));
+            Edge* e = edges.find(key);
+            if (!e) edges[key] = {f, none, false};
+            else e->second = f;
+        }
+    }
+    const auto replace = [&](uint a, uint b, uint from, uint to) {
+        Edge& e = edges[edgeKey(a, b)];
+        if (e.first == from) e.first = to;
+        else if (e.second == from) e.second = to;
+    };
+
+    // Ring buffer of the queued edges, each at most once
+    std::vector<uint64_t> queue(edges.size());
+    size_t head = 0, queueSize = 0;
+    const auto push = [&](uint64_t key) {
+        Edge* e = edges.find(key);
+        if (!e || e->second == none || e->queued) return;
+        e->queued = true;
+        queue[(head + queueSize++) % queue.size()] = key;
+    };
+    for (uint f = 0; f < faceNum(); ++f) {
+        for (uint k = 0; k < 3; ++k)
+            push(edgeKey(cFacei(f, k), cFacei(f, (k+1)%3)));
+    }
+    // The metric changes from edge to edge, so flips are not guaranteed to
+    // terminate on their own
+    const uint maxFlips = 8 * edges.size();
+    uint flips = 0;
+    while (queueSize > 0 && flips < maxFlips) {
+        const uint64_t key = queue[head];
+        head = (head + 1) % queue.size();
+        --queueSize;
+        Edge* e = edges.find(key);
+        e->queued = false;
+        if (e->second == none) continue;
+
+        // Rotate f to (a, b, c) and g to (b, a, d)
+        uint f = e->first, g = e->second;
+        uint k = 0;
+        while (edgeKey(cFacei(f, k), cFacei(f, (k+1)%3)) != key) ++k;
+        const uint a = cFacei(f, k), b = cFacei(f, (k+1)%3),
+            c = cFacei(f, (k+2)%3);
+        uint d = 0;
+        for (uint j = 0; j < 3; ++j) {
+            if (cFacei(g, j) != a && cFacei(g, j) != b) d = cFacei(g, j);
+        }
+        const glm::dvec2 pa = point(a), pb = near(point(b), pa),
+            pc = near(point(c), pa), pd = near(point(d), pa);
+        // The new triangles must stay valid in the plane
+        if (orient(pa, pd, pc) <= 0 || orient(pd, pb, pc) <= 0) continue;
+
+        // In-circle test after mapping the metric at the edge midpoint to
+        // the identity (x -> L^T x, where M = L L^T)
+        glm::dvec2 mid = (pa + pb) * .5;
+        for (uint k = 0; k < 2; ++k)
+            if (periodic[k]) mid[k] -= std::floor(mid[k]);
+        const glm::dmat2 m = metric(mid.x, mid.y);
+        const double l00 = sqrt(m[0][0]), l10 = m[0][1] / l00;
+        const double l11 = sqrt(std::max(0., m[1][1] - l10 * l10));
+        const auto map = [&](glm::dvec2 p) {
+            return glm::dvec2(l00 * p.x + l10 * p.y, l11 * p.y);
+        };
+        if (!inCircle(map(pa), map(pb), map(pc), map(pd))) continue;
+
+        // Flip: f = (a, d, c), g = (d, b, c)
+        faces[3*f+0] = a; faces[3*f+1] = d; faces[3*f+2] = c;
+        faces[3*g+0] = d; faces[3*g+1] = b; faces[3*g+2] = c;
+        edges.erase(key);
+        Edge& diagonal = edges[edgeKey(c, d)];
+        diagonal.first = f;
+        diagonal.second = g;
+        replace(a, d, g, f);
+        replace(b, c, f, g);
+        ++flips;
+        for (const uint64_t next : {edgeKey(a, d), edgeKey(d, b),
+            edgeKey(b, c), edgeKey(c, a)}) push(next);
+    }
+    return flips;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define PLANESAMPLING_H
 
 #include "Mesh.hpp"
+#include <functional>
 extern "C" {
 	#include "triangle/triangle.h"
 }
@@ -10,8 +11,16 @@ class PlaneSampling {
 	public:
     Mesh::vArray verts;     // vertices in 2D
     Mesh::fArray faces;
+	// Domain of the triangulation: the unit square (with Triangle), or the
+	// flat cylinder (periodic in u) or torus (periodic in u and v), with the
+	// in-tree Delaunay triangulator; faces across a seam join the points on
+	// either side, which are never duplicated
+	enum Periodicity { SQUARE, CYLINDER, TORUS };
+	Periodicity periodicity = SQUARE;
     PlaneSampling(std::string path);
-	PlaneSampling(std::vector<glm::dvec2> positions);
+	// Triangulations are cached, and kept in cacheFolder if not empty
+	PlaneSampling(std::vector<glm::dvec2> positions,
+		Periodicity periodicity = SQUARE, const std::string& cacheFolder = "");
 	// Get vertex and face number
 	const inline uint vertNum() const { return verts.size()/2; }
 	const inline uint faceNum() const { return faces.size()/3; }
@@ -23,7 +32,11 @@ class PlaneSampling {
 	const inline uint cFacei(uint faceId, uint n) const {
 		return faces[3 * faceId + n];
 	}
+	// Export as OFF, in the plane z = 0
 	void print(std::string path);
+	// Lawson flips towards the Delaunay triangulation in a metric tensor
+	// field, evaluated at edge midpoints; returns the number of flips
+	uint flip(const std::function<glm::dmat2(double, double)>& metric);
 };
 
 #endif
\ No newline at end of file
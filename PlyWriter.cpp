@@ -0,0 +1,48 @@
+#include "PlyWriter.hpp"
+
+PlyWriter::PlyWriter(std::ostream& stream, Format format) :
+    PlyWriter(stream, format, true) {}
+
+PlyWriter::PlyWriter(std::ostream& stream, Format format, bool header) :
+    out(stream), format(format) {
+    if (!header) return;
+    out << "ply" << std::endl;
+    // Binary rows are written in host order, which we assume little endian
+    out << (format == BINARY ? "format binary_little_endian 1.0" :
+        "format ascii 1.0") << std::endl;
+    out << std::setprecision(std::numeric_limits<double>::digits10 + 1);
+}
+
+void PlyWriter::comment(const std::string& text) {
+    out << "comment " << text << std::endl;
+}
+
+void PlyWriter::element(const std::string& name, size_t count) {
+    out << "element " << name << " " << count << std::endl;
+}
+
+void PlyWriter::property(const std::string& name) {
+    out << "property double " << name << std::endl;
+}
+
+void PlyWriter::listProperty(const std::string& name) {
+    out << "property list uchar int " << name << std::endl;
+}
+
+void PlyWriter::endHeader() {
+    out << "end_header" << std::endl;
+}
+
+void PlyWriter::list(const uint* items, unsigned char n) {
+    if (format == BINARY) {
+        out.write(reinterpret_cast<const char*>(&n), 1);
+        for (unsigned char j = 0; j < n; ++j) {
+            const int32_t item = items[j];
+            out.write(reinterpret_cast<const char*>(&item), sizeof(int32_t));
+        }
+    }
+    else {
+        out << static_cast<uint>(n) << ' ';
+        for (unsigned char j = 0; j < n; ++j) out << items[j] << ' ';
+    }
+}
\ No newline at end of file
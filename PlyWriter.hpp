@@ -0,0 +1,46 @@
+#ifndef PLYWRITER_H
+#define PLYWRITER_H
+
+#include <ostream>
+#include <string>
+#include <iomanip>
+#include <limits>
+#include <cstdint>
+#include <sys/types.h>
+
+// Streaming writer for PLY files: the header is declared element by element,
+// then rows are written one value at a time in a single sequential pass
+class PlyWriter {
+    public:
+        enum Format { ASCII, BINARY };
+
+        PlyWriter(std::ostream& stream, Format format = ASCII);
+        // Writer for rows of the same file on another stream (e.g. a chunk
+        // formatted in parallel), which must share this stream's format flags
+        inline PlyWriter rows(std::ostream& stream) const {
+            return PlyWriter(stream, format, false);
+        }
+
+        // Header
+        void comment(const std::string& text);
+        void element(const std::string& name, size_t count);
+        void property(const std::string& name);      // double
+        void listProperty(const std::string& name);  // uchar count, int items
+        void endHeader();
+
+        // Body
+        inline void value(double v) {
+            if (format == BINARY)
+                out.write(reinterpret_cast<const char*>(&v), sizeof(double));
+            else out << v << ' ';
+        }
+        void list(const uint* items, unsigned char n);
+        inline void endRow() { if (format == ASCII) out << '\n'; }
+
+    private:
+        PlyWriter(std::ostream& stream, Format format, bool header);
+        std::ostream& out;
+        const Format format;
+};
+
+#endif
\ No newline at end of file
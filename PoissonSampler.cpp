@@ -0,0 +1,212 @@
+#include "PoissonSampler.hpp"
+#include <algorithm>
+#include <queue>
+
+namespace {
+    // Maximal Poisson disk sets cover about this much of the area with
+    // disks of radius r/2
+    const double MPS_COVERAGE = .547;
+    // Weight exponent for sample elimination
+    const double ELIMINATION_ALPHA = 8;
+    // Upper bound on the grid size, to keep memory in check
+    const uint MAX_GRID = 1024;
+}
+
+PoissonSampler::PoissonSampler(Metric metric, const UVSampler& candidates,
+    uint resolution, bool periodicU, bool periodicV) :
+    metric(metric), candidates(candidates), periodic{periodicU, periodicV} {
+    // Area and smallest eigenvalue, tabulated at cell centers
+    const uint res = resolution;
+    std::vector<double> area(res * res), lmin(res * res);
+    #pragma omp parallel for
+    for (uint j = 0; j < res; ++j) {
+        for (uint i = 0; i < res; ++i) {
+            const glm::dmat2 g = metric((i + .5) / res, (j + .5) / res);
+            const double tr = g[0][0] + g[1][1];
+            const double det = std::max(0., glm::determinant(g));
+            area[j * res + i] = sqrt(det) / (res * res);
+            lmin[j * res + i] =
+                (tr - sqrt(std::max(0., tr * tr - 4 * det))) / 2;
+        }
+    }
+    for (double a : area) totalArea += a;
+    // Margin for the parts of the cells that were not sampled
+    minEigen = .8 * *std::min_element(lmin.begin(), lmin.end());
+}
+
+double PoissonSampler::radius(uint n) const {
+    return sqrt(4 * MPS_COVERAGE * totalArea / (M_PI * n));
+}
+
+uint PoissonSampler::gridSize(double radius) const {
+    // A metric disk spans at most radius / sqrt(minEigen) in UV
+    if (minEigen <= 0) return 1;
+    const double h = radius / sqrt(minEigen);
+    uint n = std::max(1., std::min<double>(MAX_GRID, std::floor(1 / h)));
+    // Cells across a periodic side must differ in parity
+    if ((periodic[0] || periodic[1]) && n > 1) n -= n % 2;
+    return n;
+}
+
+uint PoissonSampler::neighbors(uint c, uint n, uint out[9]) const {
+    const int cx = c % n, cy = c / n;
+    uint count = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+        int y = cy + dy;
+        if (periodic[1]) y = (y + n) % n;
+        else if (y < 0 || y >= int(n)) continue;
+        for (int dx = -1; dx <= 1; ++dx) {
+            int x = cx + dx;
+            if (periodic[0]) x = (x + n) % n;
+            else if (x < 0 || x >= int(n)) continue;
+            const uint k = y * n + x;
+            if (std::find(out, out + count, k) == out + count)
+                out[count++] = k;
+        }
+    }
+    return count;
+}
+
+std::vector<PoissonSampler::Site> PoissonSampler::sites(
+    const std::vector<glm::dvec2>& p) const {
+    std::vector<Site> s(p.size());
+    #pragma omp parallel for
+    for (uint i = 0; i < p.size(); ++i) {
+        s[i].p = p[i];
+        s[i].g = metric(p[i].x, p[i].y);
+    }
+    return s;
+}
+
+
+std::vector<glm::dvec2> PoissonSampler::dartThrowing(double radius,
+    const std::vector<glm::dvec2>& fixed, uint candidatesPerPoint) const {
+    const double r2 = radius * radius;
+    const uint n = gridSize(radius);
+
+    // Candidate pool, bucketed by cell in draw order
+    const uint expected = totalArea * MPS_COVERAGE * 4 / (M_PI * r2);
+    std::vector<glm::dvec2> pool(candidatesPerPoint * expected);
+    candidates.sampleUV(pool.size(), pool.data());
+    const std::vector<Site> poolSites = sites(pool);
+    std::vector<std::vector<uint>> byCell(n * n);
+    for (uint i = 0; i < pool.size(); ++i)
+        byCell[cellOf(pool[i], n)].push_back(i);
+
+    // Accepted sites per cell, starting with the fixed ones
+    std::vector<std::vector<Site>> cells(n * n);
+    for (const Site& s : sites(fixed)) cells[cellOf(s.p, n)].push_back(s);
+    const std::vector<uint> fixedCount = [&]() {
+        std::vector<uint> c(n * n);
+        for (uint k = 0; k < n * n; ++k) c[k] = cells[k].size();
+        return c;
+    }();
+
+    for (uint phase = 0; phase < 4; ++phase) {
+        const uint px = phase % 2, py = phase / 2;
+        const uint nx = (n - px + 1) / 2, ny = (n - py + 1) / 2;
+        #pragma omp parallel for schedule(dynamic)
+        for (uint k = 0; k < nx * ny; ++k) {
+            const uint cx = 2 * (k % nx) + px, cy = 2 * (k / nx) + py;
+            std::vector<Site>& own = cells[cy * n + cx];
+            uint nb[9];
+            const uint count = neighbors(cy * n + cx, n, nb);
+            for (uint i : byCell[cy * n + cx]) {
+                const Site& s = poolSites[i];
+                bool free = true;
+                for (uint m = 0; free && m < count; ++m) {
+                    for (const Site& t : cells[nb[m]]) {
+                        if (distance2(s, t) < r2) {
+                            free = false;
+                            break;
+                        }
+                    }
+                }
+                if (free) own.push_back(s);
+            }
+        }
+    }
+
+    // Fixed points first, then new ones by cell
+    std::vector<glm::dvec2> result(fixed);
+    for (uint k = 0; k < n * n; ++k) {
+        for (uint i = fixedCount[k]; i < cells[k].size(); ++i)
+            result.push_back(cells[k][i].p);
+    }
+    return result;
+}
+
+
+std::vector<glm::dvec2> PoissonSampler::eliminate(uint n,
+    const std::vector<glm::dvec2>& fixed, double factor) const {
+    std::vector<glm::dvec2> result(fixed);
+    if (n <= fixed.size()) return result;
+    const uint target = n - fixed.size();
+
+    // Candidates, with factor times as many points as needed
+    std::vector<glm::dvec2> pool(std::ceil(factor * target));
+    candidates.sampleUV(pool.size(), pool.data());
+    const std::vector<Site> poolSites = sites(pool);
+    const std::vector<Site> fixedSites = sites(fixed);
+
+    // Points interact up to twice the radius of a dense packing
+    const double rMax = sqrt(totalArea / (2 * sqrt(3) * n));
+    const double reach = 2 * rMax;
+    const uint g = gridSize(reach);
+    std::vector<std::vector<uint>> poolCells(g * g), fixedCells(g * g);
+    for (uint i = 0; i < pool.size(); ++i)
+        poolCells[cellOf(pool[i], g)].push_back(i);
+    for (uint i = 0; i < fixed.size(); ++i)
+        fixedCells[cellOf(fixed[i], g)].push_back(i);
+
+    // Weights and contributions of each neighbor
+    std::vector<double> weight(pool.size(), 0);
+    std::vector<std::vector<std::pair<uint, double>>> nbr(pool.size());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (uint i = 0; i < pool.size(); ++i) {
+        const Site& s = poolSites[i];
+        uint nb[9];
+        const uint count = neighbors(cellOf(s.p, g), g, nb);
+        for (uint m = 0; m < count; ++m) {
+            for (uint j : poolCells[nb[m]]) {
+                if (j == i) continue;
+                const double d = sqrt(distance2(s, poolSites[j]));
+                if (d >= reach) continue;
+                const double w = pow(1 - d / reach, ELIMINATION_ALPHA);
+                nbr[i].push_back(std::make_pair(j, w));
+                weight[i] += w;
+            }
+            // Fixed points push candidates away, but stay
+            for (uint j : fixedCells[nb[m]]) {
+                const double d = sqrt(distance2(s, fixedSites[j]));
+                if (d < reach)
+                    weight[i] += pow(1 - d / reach, ELIMINATION_ALPHA);
+            }
+        }
+    }
+
+    // Remove the most crowded candidate until the count is reached;
+    // stale heap entries are skipped
+    std::priority_queue<std::pair<double, uint>> heap;
+    for (uint i = 0; i < pool.size(); ++i)
+        heap.push(std::make_pair(weight[i], i));
+    std::vector<bool> removed(pool.size(), false);
+    uint remaining = pool.size();
+    while (remaining > target) {
+        const auto top = heap.top();
+        heap.pop();
+        const uint i = top.second;
+        if (removed[i] || top.first != weight[i]) continue;
+        removed[i] = true;
+        --remaining;
+        for (const auto& nw : nbr[i]) {
+            if (removed[nw.first]) continue;
+            weight[nw.first] -= nw.second;
+            heap.push(std::make_pair(weight[nw.first], nw.first));
+        }
+    }
+
+    for (uint i = 0; i < pool.size(); ++i)
+        if (!removed[i]) result.push_back(pool[i]);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef POISSONSAMPLER_H
+#define POISSONSAMPLER_H
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "UVSampler.hpp"
+
+// Blue noise point sets in the parametric square: no two points are closer
+// than a radius, measured with a metric tensor g(u,v) (e.g. the first
+// fundamental form of the surface). Candidates are drawn from a UVSampler
+// and bucketed in a regular grid over UV, with cells at least one radius
+// wide in the metric. On periodic sides, distances and cells wrap around.
+class PoissonSampler {
+    public:
+        typedef std::function<glm::dmat2(double, double)> Metric;
+
+        PoissonSampler(Metric metric, const UVSampler& candidates,
+            uint resolution = 64, bool periodicU = false,
+            bool periodicV = false);
+
+        // Dart throwing around fixed points (e.g. the border). Cells of the
+        // same parity are never adjacent, so each of the four phase groups
+        // is processed in parallel; the result is independent of the
+        // thread count.
+        std::vector<glm::dvec2> dartThrowing(double radius,
+            const std::vector<glm::dvec2>& fixed,
+            uint candidatesPerPoint = 8) const;
+        // Weighted sample elimination: exactly n points (fixed ones
+        // included) kept out of factor times as many candidates
+        std::vector<glm::dvec2> eliminate(uint n,
+            const std::vector<glm::dvec2>& fixed, double factor = 5) const;
+
+        // Dart throwing radius which gives about n points
+        double radius(uint n) const;
+        inline double area() const { return totalArea; }
+
+    private:
+        struct Site {
+            glm::dvec2 p;
+            glm::dmat2 g;
+        };
+        // Squared distance, with the metric averaged between the points
+        inline double distance2(const Site& a, const Site& b) const {
+            glm::dvec2 d = b.p - a.p;
+            for (uint k = 0; k < 2; ++k)
+                if (periodic[k]) d[k] -= std::round(d[k]);
+            const glm::dmat2 g = (a.g + b.g) * .5;
+            return glm::dot(d, g * d);
+        }
+        // Cells per side for a given metric radius
+        uint gridSize(double radius) const;
+        static inline uint cellOf(glm::dvec2 p, uint n) {
+            const uint i = std::min(n - 1, static_cast<uint>(p.x * n));
+            const uint j = std::min(n - 1, static_cast<uint>(p.y * n));
+            return j * n + i;
+        }
+        // Cells within one step of c, each listed once; returns the count
+        uint neighbors(uint c, uint n, uint out[9]) const;
+        std::vector<Site> sites(const std::vector<glm::dvec2>& p) const;
+
+        const Metric metric;
+        const UVSampler& candidates;
+        double totalArea = 0;
+        double minEigen = 0;    // smallest eigenvalue of the metric
+        const bool periodic[2];
+};
+
+#endif
\ No newline at end of file
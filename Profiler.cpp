@@ -0,0 +1,183 @@
+#include "Profiler.hpp"
+
+#ifdef NICE_PROFILE
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace {
+    struct Event {
+        const char* name;
+        int64_t start, end;
+        std::string job;
+    };
+    // Events of one thread, kept until the trace is written
+    struct Buffer {
+        uint thread;
+        std::vector<Event> events;
+    };
+
+    thread_local Profiler::Job* currentJob = nullptr;
+    thread_local Buffer* buffer = nullptr;
+    std::atomic<bool> tracing(false);
+    std::string tracePath;
+    std::vector<Buffer*> buffers;
+    std::mutex buffersMtx;
+    std::vector<Profiler::Total> jobTotals;
+    std::mutex totalsMtx;
+    const int64_t origin = Profiler::now();
+
+    Buffer* threadBuffer() {
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(buffersMtx);
+            buffer = new Buffer{static_cast<uint>(buffers.size()), {}};
+            buffers.push_back(buffer);
+        }
+        return buffer;
+    }
+
+    std::string quoted(const std::string& s) {
+        std::string q = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') q += '\\';
+            q += c;
+        }
+        return q + '"';
+    }
+}
+
+
+Profiler::Job::Job(const std::string& config, size_t index,
+    const std::string& name) :
+    config(config), name(name), index(index), start(now()) {}
+
+void Profiler::Job::write(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<std::pair<std::string, Stage>> sorted(stages.begin(),
+        stages.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second.order < b.second.order;
+    });
+    {
+        std::lock_guard<std::mutex> lock(totalsMtx);
+        for (const auto& kv : sorted) {
+            auto t = std::find_if(jobTotals.begin(), jobTotals.end(),
+                [&](const Total& t) { return t.name == kv.first; });
+            if (t == jobTotals.end()) {
+                jobTotals.push_back({kv.first, 0, 0, 0});
+                t = jobTotals.end() - 1;
+            }
+            t->count += kv.second.count;
+            t->total += kv.second.total;
+            t->peakRSS = std::max(t->peakRSS, kv.second.peakRSS);
+        }
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) return;
+    const double mb = 1 << 20;
+    out << "{\n  \"config\": " << quoted(config) << ",\n";
+    out << "  \"job\": " << index << ",\n";
+    out << "  \"name\": " << quoted(name) << ",\n";
+    out << "  \"wall_ms\": " << (now() - start) * 1e-6 << ",\n";
+    out << "  \"rss_mb\": " << rss() / mb << ",\n";
+    out << "  \"peak_rss_mb\": " << peakRSS() / mb << ",\n";
+    out << "  \"stages\": [";
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Stage& s = sorted[i].second;
+        out << (i ? ",\n" : "\n") << "    {\"name\": " <<
+            quoted(sorted[i].first) << ", \"count\": " << s.count <<
+            ", \"total_ms\": " << s.total << ", \"max_ms\": " << s.max <<
+            ", \"peak_rss_mb\": " << s.peakRSS / mb <<
+            ", \"peak_growth_mb\": " << s.peakGrowth / mb << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+
+Profiler::Attach::Attach(Job* job) : previous(currentJob) {
+    currentJob = job;
+}
+
+Profiler::Attach::~Attach() {
+    currentJob = previous;
+}
+
+
+Profiler::Scope::Scope(const char* name) :
+    name(name), start(now()), startPeak(peakRSS()) {}
+
+Profiler::Scope::~Scope() {
+    const int64_t end = now();
+    if (currentJob) {
+        const size_t peak = peakRSS();
+        const double ms = (end - start) * 1e-6;
+        std::lock_guard<std::mutex> lock(currentJob->mtx);
+        Job::Stage& s = currentJob->stages[name];
+        if (s.count++ == 0) s.order = currentJob->stages.size();
+        s.total += ms;
+        s.max = std::max(s.max, ms);
+        s.peakRSS = std::max(s.peakRSS, peak);
+        s.peakGrowth = std::max(s.peakGrowth, peak - startPeak);
+    }
+    if (tracing.load(std::memory_order_relaxed)) {
+        threadBuffer()->events.push_back({name, start, end,
+            currentJob ? currentJob->name : ""});
+    }
+}
+
+
+void Profiler::trace(const std::string& path) {
+    tracePath = path;
+    tracing = true;
+}
+
+void Profiler::finish() {
+    if (!tracing) return;
+    tracing = false;
+    std::ofstream out(tracePath);
+    if (!out.is_open()) return;
+    // Complete events, in microseconds
+    std::lock_guard<std::mutex> lock(buffersMtx);
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (const Buffer* b : buffers) {
+        for (const Event& e : b->events) {
+            out << (first ? "\n" : ",\n") << "{\"name\": " <<
+                quoted(e.name) << ", \"ph\": \"X\", \"pid\": 0, \"tid\": " <<
+                b->thread << ", \"ts\": " << (e.start - origin) * 1e-3 <<
+                ", \"dur\": " << (e.end - e.start) * 1e-3;
+            if (!e.job.empty())
+                out << ", \"args\": {\"job\": " << quoted(e.job) << "}";
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+std::vector<Profiler::Total> Profiler::totals() {
+    std::lock_guard<std::mutex> lock(totalsMtx);
+    return jobTotals;
+}
+
+size_t Profiler::rss() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+size_t Profiler::peakRSS() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss) << 10;  // from KB
+}
+
+int64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "AllocationTracker.hpp"
+
+// Stage timers, compiled in with NICE_PROFILE (make PROFILE=1).
+// PROFILE_SCOPE("name") times the rest of the enclosing block. Scopes are
+// attributed to the job attached to the thread they run on (see Attach),
+// whose stages are summed up in a JSON file; all scopes can also be
+// recorded as a Chrome trace (chrome://tracing, Perfetto). Scopes nest, so
+// stage times are inclusive. Memory figures are those of the process, as
+// jobs share it. Scopes also tag the allocations of their stage, in builds
+// with NICE_ALLOC_TRACK.
+#ifdef NICE_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) \
+    Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name); \
+    ALLOC_SCOPE(name)
+#else
+#define PROFILE_SCOPE(name) ALLOC_SCOPE(name)
+#endif
+
+#ifdef NICE_PROFILE
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+class Profiler {
+    public:
+        // A stage summed over all the jobs written so far
+        struct Total {
+            std::string name;
+            uint count;
+            double total;           // ms
+            size_t peakRSS;         // bytes
+        };
+
+        // Stages of a job, which can run on several threads (e.g.
+        // generation, then writing)
+        class Job {
+            public:
+                Job(const std::string& config, size_t index,
+                    const std::string& name);
+                void write(const std::string& path);
+
+            private:
+                friend class Profiler;
+                struct Stage {
+                    uint count = 0;
+                    uint order;             // of first completion
+                    double total = 0, max = 0;  // ms
+                    size_t peakRSS = 0, peakGrowth = 0;     // bytes
+                };
+                const std::string config, name;
+                const size_t index;
+                const int64_t start;
+                std::map<std::string, Stage> stages;
+                std::mutex mtx;
+        };
+
+        // Scopes of this thread count for the job until destruction
+        class Attach {
+            public:
+                Attach(Job* job);
+                ~Attach();
+            private:
+                Job* previous;
+        };
+
+        class Scope {
+            public:
+                Scope(const char* name);
+                ~Scope();
+            private:
+                const char* name;
+                const int64_t start;
+                const size_t startPeak;
+        };
+
+        // Record every scope, to be written by finish()
+        static void trace(const std::string& path);
+        static void finish();
+        // In order of first completion
+        static std::vector<Total> totals();
+
+        static size_t rss();        // resident set size, bytes
+        static size_t peakRSS();    // highest resident set size so far
+        static int64_t now();       // ns since an arbitrary origin
+};
+
+#else
+// Stand-ins, so that callers need no preprocessor conditionals
+class Profiler {
+    public:
+        struct Total {
+            std::string name;
+            uint count;
+            double total;
+            size_t peakRSS;
+        };
+        class Job {
+            public:
+                Job(const std::string&, size_t, const std::string&) {}
+                void write(const std::string&) {}
+        };
+        class Attach {
+            public:
+                Attach(Job*) {}
+        };
+        static void trace(const std::string&) {}
+        static void finish() {}
+        static std::vector<Total> totals() { return {}; }
+};
+#endif
+
+#endif
\ No newline at end of file
@@ -1,11 +1,205 @@
 #include "RandPoint.hpp"
+#include <algorithm>
 
-glm::dvec2 RandPoint::inTriangle(glm::dvec2 v1, glm::dvec2 v2, glm::dvec2 v3) {
-	const double p = glm::linearRand<double>(0, 1);
-	const double q = glm::linearRand<double>(0, 1);
+namespace {
+	thread_local uint64_t seedValue = 0;
+	thread_local uint64_t currentKey = RandPoint::mix(0);
+	thread_local RandPoint::Stream currentStream(currentKey);
+
+	// Philox rounds on plain scalars, so that batch loops can vectorize
+	inline void philoxRounds(uint32_t& c0, uint32_t& c1, uint32_t& c2,
+		uint32_t& c3, uint32_t k0, uint32_t k1) {
+		const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+		const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+		for (uint r = 0; r < 10; ++r) {
+			const uint64_t p0 = static_cast<uint64_t>(M0) * c0;
+			const uint64_t p1 = static_cast<uint64_t>(M1) * c2;
+			const uint32_t n0 = (p1 >> 32) ^ c1 ^ k0;
+			const uint32_t n2 = (p0 >> 32) ^ c3 ^ k1;
+			c1 = p1;
+			c3 = p0;
+			c0 = n0;
+			c2 = n2;
+			k0 += W0;
+			k1 += W1;
+		}
+	}
+
+	inline double toUniform(uint32_t hi, uint32_t lo) {
+		// 53 random bits
+		return ((hi >> 5) * 67108864.0 + (lo >> 6)) / 9007199254740992.0;
+	}
+
+	// Batches are computed in tiles of blocks, two variates per block
+	const size_t tileBlocks = 256;
+	const size_t tileSize = 2 * tileBlocks;
+
+	void uniformTile(uint64_t key, uint64_t tile, double* u) {
+		const uint64_t first = tile * tileBlocks;
+		#pragma omp simd
+		for (size_t j = 0; j < tileBlocks; ++j) {
+			const uint64_t block = first + j;
+			uint32_t c0 = block, c1 = block >> 32, c2 = 0, c3 = 0;
+			philoxRounds(c0, c1, c2, c3, key, key >> 32);
+			u[2*j] = toUniform(c0, c1);
+			u[2*j+1] = toUniform(c2, c3);
+		}
+	}
+
+	void gaussianTile(uint64_t key, uint64_t tile, double* u) {
+		uniformTile(key, tile, u);
+		// Box-Muller on each pair, with the radius drawn from (0,1]
+		#pragma omp simd
+		for (size_t j = 0; j < tileBlocks; ++j) {
+			const double r = sqrt(-2 * log(1 - u[2*j]));
+			const double t = 2 * M_PI * u[2*j+1];
+			u[2*j] = r * cos(t);
+			u[2*j+1] = r * sin(t);
+		}
+	}
+
+	// Elements [first, first+n) of a batch, tiles spread over threads
+	template <typename Kernel>
+	void fill(uint64_t key, size_t first, size_t n, double scale,
+		double* out, Kernel kernel) {
+		if (n == 0) return;
+		const size_t end = first + n;
+		const size_t t0 = first / tileSize, t1 = (end - 1) / tileSize + 1;
+		#pragma omp parallel for if (t1 - t0 > 1)
+		for (size_t t = t0; t < t1; ++t) {
+			double u[tileSize];
+			kernel(key, t, u);
+			const size_t lo = std::max(first, t * tileSize);
+			const size_t hi = std::min(end, (t + 1) * tileSize);
+			for (size_t i = lo; i < hi; ++i)
+				out[i - first] = u[i - t * tileSize] * scale;
+		}
+	}
+}
+
+void RandPoint::philox(const uint32_t counter[4], uint64_t key,
+	uint32_t out[4]) {
+	out[0] = counter[0];
+	out[1] = counter[1];
+	out[2] = counter[2];
+	out[3] = counter[3];
+	philoxRounds(out[0], out[1], out[2], out[3], key, key >> 32);
+}
+
+uint64_t RandPoint::mix(uint64_t x) {
+	// splitmix64 finalizer
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+uint64_t RandPoint::hash(const std::string& s) {
+	// FNV-1a
+	uint64_t h = 0xCBF29CE484222325ull;
+	for (char c : s) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 0x100000001B3ull;
+	}
+	return mix(h);
+}
+
+
+uint32_t RandPoint::Stream::next() {
+	if (pos == 4) {
+		const uint32_t ctr[4] = {
+			static_cast<uint32_t>(counter),
+			static_cast<uint32_t>(counter >> 32),
+			static_cast<uint32_t>(index),
+			static_cast<uint32_t>(index >> 32)
+		};
+		philox(ctr, key, block);
+		++counter;
+		pos = 0;
+	}
+	return block[pos++];
+}
+
+double RandPoint::Stream::uniform() {
+	const uint32_t hi = next();
+	return toUniform(hi, next());
+}
+
+double RandPoint::Stream::gaussian(double deviation) {
+	if (hasSpare) {
+		hasSpare = false;
+		return spare * deviation;
+	}
+	// Box-Muller, with the radius drawn from (0,1]
+	const double r = sqrt(-2 * log(1 - uniform()));
+	const double t = 2 * M_PI * uniform();
+	spare = r * sin(t);
+	hasSpare = true;
+	return r * cos(t) * deviation;
+}
+
+uint64_t RandPoint::Stream::split() {
+	const uint64_t hi = next();
+	return mix((hi << 32) | next());
+}
+
+
+uint RandPoint::seed(uint seed) {
+	seedValue = seed;
+	job(0, 0);
+	return seed;
+}
+
+void RandPoint::job(uint64_t config, uint64_t repeat) {
+	currentKey = mix(mix(mix(seedValue) ^ config) ^ repeat);
+	currentStream = Stream(currentKey);
+}
+
+uint64_t RandPoint::jobKey() {
+	return currentKey;
+}
+
+RandPoint::Stream& RandPoint::current() {
+	return currentStream;
+}
+
+
+void RandPoint::uniforms(uint64_t key, size_t first, size_t n, double* out) {
+	fill(key, first, n, 1, out, uniformTile);
+}
+
+void RandPoint::gaussians(uint64_t key, size_t first, size_t n,
+	double deviation, double* out) {
+	fill(key, first, n, deviation, out, gaussianTile);
+}
+
+
+glm::dvec3 RandPoint::onSphere(double radius, Stream& s) {
+	glm::dvec3 p;
+	do { p = gaussian3(1, s); } while (glm::dot(p, p) == 0);
+	return glm::normalize(p) * radius;
+}
+
+glm::dvec3 RandPoint::inSphere(double radius, Stream& s) {
+	glm::dvec3 p;
+	do {
+		p = glm::dvec3(s.uniform(-1, 1), s.uniform(-1, 1), s.uniform(-1, 1));
+	} while (glm::dot(p, p) > 1);
+	return p * radius;
+}
+
+glm::dvec2 RandPoint::inTriangle(glm::dvec2 v1, glm::dvec2 v2, glm::dvec2 v3,
+	Stream& s) {
+	const double p = s.uniform();
+	const double q = s.uniform();
+	return inTriangle(v1, v2, v3, p, q);
+}
+
+glm::dvec2 RandPoint::inTriangle(glm::dvec2 v1, glm::dvec2 v2, glm::dvec2 v3,
+	double p, double q) {
 	const double dif = std::abs(p-q);
 	const double a = (p + q - dif) / 2;
 	const double b = dif;
 	const double c = 1 - (p + q + dif) / 2;
 	return glm::dvec1(a) * v1 + glm::dvec1(b) * v2 + glm::dvec1(c) * v3;
-}  
\ No newline at end of file
+}
\ No newline at end of file
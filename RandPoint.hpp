@@ -2,45 +2,83 @@
 #define RANDPOINT_H
 
 #include <glm/glm.hpp>
-#include <glm/gtc/random.hpp>
+#include <cstdint>
+#include <string>
+#include <ctime>
 
 // Random number generation
+// All draws come from a counter-based generator (Philox4x32-10): the n-th
+// number of a stream is a pure function of (key, stream index, n), so any
+// loop can hand out one stream per element and give the same result at any
+// thread count. Keys are derived from (seed, config, repeat index).
 namespace RandPoint {
-    inline uint seed(uint seed = time(0)) {
-        srand(seed); // get random seed
-        return seed;
-    }
+    class Stream {
+        public:
+            Stream(uint64_t key = 0, uint64_t index = 0) :
+                key(key), index(index) {}
 
-    inline glm::dvec1 gaussian1(double variance) {
-        return glm::dvec1(
-            glm::gaussRand<double>(0., variance)
-        );
-    }
+            uint32_t next();            // 32 random bits
+            double uniform();           // in [0,1)
+            inline double uniform(double a, double b) {
+                return a + (b - a) * uniform();
+            }
+            double gaussian(double deviation = 1);
+            // Key for an independent family of streams
+            uint64_t split();
 
-    inline glm::dvec2 gaussian2(double variance) {
-        return glm::dvec2(
-            glm::gaussRand<double>(0., variance),
-            glm::gaussRand<double>(0., variance)
-        );
-    }
+        private:
+            uint64_t key, index;
+            uint64_t counter = 0;
+            uint32_t block[4];
+            uint pos = 4;               // next word in block
+            double spare;               // second Box-Muller variate
+            bool hasSpare = false;
+    };
+
+    // Philox4x32-10 block function
+    void philox(const uint32_t counter[4], uint64_t key, uint32_t out[4]);
+    // Mixing functions used to derive keys
+    uint64_t mix(uint64_t x);
+    uint64_t hash(const std::string& s);
 
-    inline glm::dvec3 gaussian3(double variance) {
-        return glm::dvec3(
-            glm::gaussRand<double>(0., variance),
-            glm::gaussRand<double>(0., variance),
-            glm::gaussRand<double>(0., variance)
-        );
+    // Per-thread generator state: seed, then the job being generated
+    uint seed(uint seed = time(0));
+    void job(uint64_t config, uint64_t repeat);
+    uint64_t jobKey();
+    // Sequential stream of the current job
+    Stream& current();
+
+    // Batch generators: element i of the batch with a given key is fixed,
+    // so a batch can be filled in pieces. Work is spread over threads
+    // unless called from a parallel region.
+    void uniforms(uint64_t key, size_t first, size_t n, double* out);
+    void gaussians(uint64_t key, size_t first, size_t n, double deviation,
+        double* out);
+
+    inline glm::dvec1 gaussian1(double variance, Stream& s = current()) {
+        return glm::dvec1(s.gaussian(variance));
     }
-    
-    inline glm::dvec3 onSphere(double radius) {
-        return glm::sphericalRand<double>(radius);
+
+    inline glm::dvec2 gaussian2(double variance, Stream& s = current()) {
+        const double x = s.gaussian(variance);
+        const double y = s.gaussian(variance);
+        return glm::dvec2(x, y);
     }
 
-    inline glm::dvec3 inSphere(double radius) {
-        return glm::ballRand<double>(radius);
+    inline glm::dvec3 gaussian3(double variance, Stream& s = current()) {
+        const double x = s.gaussian(variance);
+        const double y = s.gaussian(variance);
+        const double z = s.gaussian(variance);
+        return glm::dvec3(x, y, z);
     }
 
-    glm::dvec2 inTriangle(glm::dvec2 v1, glm::dvec2 v2, glm::dvec2 v3);
+    glm::dvec3 onSphere(double radius, Stream& s = current());
+    glm::dvec3 inSphere(double radius, Stream& s = current());
+    glm::dvec2 inTriangle(glm::dvec2 v1, glm::dvec2 v2, glm::dvec2 v3,
+        Stream& s = current());
+    // Area preserving map of the unit square onto the triangle
+    glm::dvec2 inTriangle(glm::dvec2 v1, glm::dvec2 v2, glm::dvec2 v3,
+        double p, double q);
 }
 
 #endif
\ No newline at end of file
@@ -1,8 +1,11 @@
 #include "ScalarField.hpp"
+#include "ChunkedOutput.hpp"
+#include "CompressedStream.hpp"
+#include "Profiler.hpp"
 
 ScalarField::ScalarField(Mesh* m, uint d, bool onFaces) :
     mesh(m), samples(onFaces ? m->faceNum() : m->vertNum()),
-    deriv((d+2) * (d+1) / 2) {
+    deriv((d+2) * (d+1) / 2), faceField(onFaces) {
     values = new double[samples * deriv];
 }
 
@@ -25,8 +28,9 @@ double ScalarField::getValue(uint i, uint du,
 }
 
 void ScalarField::write(std::string path, bool header) const {
+    PROFILE_SCOPE("writeScalarField");
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw Mesh::FileOpenException();
 
     // Write header
@@ -34,12 +38,13 @@ void ScalarField::write(std::string path, bool header) const {
         file << "SCALAR_FIELD " << samples << std::endl;
     }
     // Write values
-    for (uint i = 0; i < samples; ++i) {
-        file << std::setprecision(DPRECIS) << getValue(i) << std::endl;
-    }
+    ChunkedOutput::write(file, samples, [&](std::ostream& out, size_t i) {
+        out << std::setprecision(DPRECIS) << getValue(i) << '\n';
+    });
 
     // Close file
     file.close();
+    if (!file) throw Mesh::FileWriteException();
 }
 
 uint ScalarField::pair(uint x, uint y) const {
@@ -12,10 +12,16 @@ class ScalarField {
         double getValue(uint i, uint uDeriv = 0,
             uint vDeriv = 0) const;
         void write(std::string path, bool header=false) const;
+        inline uint size() const { return samples; }
+        inline size_t byteSize() const {
+            return samples * deriv * sizeof(double);
+        }
+        inline bool onFaces() const { return faceField; }
         class TooManyValuesException;
     private:
         const Mesh* mesh;
         const uint samples, deriv;
+        const bool faceField;
         double* values;
         uint pair(uint x, uint y) const;
 };
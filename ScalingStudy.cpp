@@ -0,0 +1,288 @@
+#include "ScalingStudy.hpp"
+#include "Manifest.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+namespace {
+    // Stage times, handed from the child process of a point to the parent
+    std::string stagesPath(const ScalingStudy::Point& p) {
+        return p.prefix + "stages.tsv";
+    }
+
+    size_t fileSize(const std::string& path) {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+    }
+
+    std::string csvText(const std::string& s) {
+        if (s.find_first_of(",\"\n") == std::string::npos) return s;
+        std::string q = "\"";
+        for (char c : s) {
+            if (c == '"') q += '"';
+            q += c;
+        }
+        return q + '"';
+    }
+
+    // Row of the summary
+    struct Efficiency {
+        const ScalingStudy::Measure* m;
+        std::string scaling;
+        double speedup, efficiency, work;
+    };
+}
+
+
+ScalingStudy::ScalingStudy(const std::vector<uint>& sizes,
+    const std::vector<uint>& threads) : sizes(sizes), threads(threads) {
+    if (this->threads.empty()) {
+        const uint available = omp_get_max_threads();
+        for (uint t = 1; t < available; t *= 2) this->threads.push_back(t);
+        this->threads.push_back(available);
+    }
+}
+
+void ScalingStudy::run(ConfigManager& cm,
+    const std::vector<std::string>& configs, const Runner& runner) {
+    for (const std::string& config : configs) {
+        JobSpec spec;
+        try {
+            spec = cm.jobs(config).common();
+        }
+        catch (ConfigManager::InvalidValueException e) {
+            std::cerr << e.what() << " (conf:" << config << ')' << std::endl;
+            continue;
+        }
+        const bool sphere = (spec.shape == JobSpec::SPHERE);
+        std::vector<uint> grid = sizes;
+        if (grid.empty()) grid.push_back(sphere ? spec.subdivision :
+            spec.samples);
+
+        Point p;
+        p.config = config;
+        p.key = sphere ? "subdivision" : "samples";
+        for (uint size : grid) {
+            for (uint t : threads) {
+                p.size = size;
+                p.threads = t;
+                p.prefix = spec.outFolder + "scaling-" + config + "-" +
+                    p.key + std::to_string(size) + "-t" +
+                    std::to_string(t) + "-";
+                p.manifest = p.prefix + "manifest.txt";
+                std::cout << config << ": " << p.key << " " << size <<
+                    ", " << t << " threads... " << std::flush;
+                done.push_back(measure(cm, p, runner));
+                const Measure& m = done.back();
+                std::cout << (m.ok ? "" : "FAILED, ") << m.seconds <<
+                    " s, " << m.peakRSS / double(1 << 20) << " MB peak, " <<
+                    m.bytes << " bytes written" << std::endl;
+            }
+        }
+    }
+}
+
+ScalingStudy::Measure ScalingStudy::measure(ConfigManager& cm,
+    const Point& p, const Runner& runner) const {
+    Measure m{p, false, 0, 0, 0, 0, 0, {}};
+    // Buffered output would be written by both processes
+    std::cout.flush();
+    std::cerr.flush();
+    const auto start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Cannot start a process for " << p.config << std::endl;
+        return m;
+    }
+    if (pid == 0) {
+        // Settings of the point, then the usual run, with errors only
+        const int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) dup2(null, STDOUT_FILENO);
+        int status = 1;
+        try {
+            cm.set(p.key, std::to_string(p.size));
+            cm.set("outFolder", p.prefix);
+            cm.set("interactive", "false");
+            omp_set_num_threads(p.threads);
+            status = runner(p);
+        }
+        catch (ConfigManager::InvalidValueException e) {
+            std::cerr << e.what() << std::endl;
+        }
+        std::ofstream out(stagesPath(p));
+        for (const Profiler::Total& t : Profiler::totals()) {
+            out << t.name << '\t' << t.count << '\t' << t.total << '\t' <<
+                t.peakRSS << '\n';
+        }
+        out.close();
+        exit(status);
+    }
+
+    int status = 0;
+    rusage usage;
+    wait4(pid, &status, 0, &usage);
+    m.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    m.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    m.peakRSS = static_cast<size_t>(usage.ru_maxrss) << 10;    // from KB
+
+    // Outputs of the jobs, which are only kept for the measure
+    Manifest manifest;
+    try {
+        manifest.read(p.manifest);
+        m.jobs = manifest.entries().size();
+        for (const Manifest::Entry& e : manifest.entries()) {
+            m.ok = m.ok && e.ok;
+            for (const auto& f : e.files) {
+                m.bytes += fileSize(f.first);
+                ++m.files;
+                std::remove(f.first.c_str());
+            }
+            std::remove((p.prefix + e.name + ".profile.json").c_str());
+        }
+    }
+    catch (Manifest::FileException e) {
+        m.ok = false;
+    }
+    std::remove(p.manifest.c_str());
+
+    std::ifstream in(stagesPath(p));
+    std::string line;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        Profiler::Total t;
+        if (std::getline(ss, t.name, '\t') &&
+            ss >> t.count >> t.total >> t.peakRSS) m.stages.push_back(t);
+    }
+    in.close();
+    std::remove(stagesPath(p).c_str());
+    return m;
+}
+
+
+void ScalingStudy::write(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) throw FileException("Cannot write " + path);
+    const double mb = 1 << 20;
+    out << "config,key,size,threads,stage,count,time_s,peak_rss_mb," <<
+        "output_bytes,files,ok\n";
+    for (const Measure& m : done) {
+        const Point& p = m.point;
+        const std::string point = csvText(p.config) + ',' + p.key + ',' +
+            std::to_string(p.size) + ',' + std::to_string(p.threads) + ',';
+        out << point << "total," << m.jobs << ',' << m.seconds << ',' <<
+            m.peakRSS / mb << ',' << m.bytes << ',' << m.files << ',' <<
+            m.ok << '\n';
+        for (const Profiler::Total& t : m.stages) {
+            out << point << csvText(t.name) << ',' << t.count << ',' <<
+                t.total * 1e-3 << ',' << t.peakRSS / mb << ",,," << m.ok <<
+                '\n';
+        }
+    }
+
+    // Strong scaling: each size against its fewest threads. Weak scaling:
+    // each thread count at the size with the closest output bytes per
+    // thread to the smallest run, against that run.
+    std::vector<Efficiency> rows;
+    std::vector<std::string> configs;
+    for (const Measure& m : done) {
+        if (std::find(configs.begin(), configs.end(), m.point.config) ==
+            configs.end()) configs.push_back(m.point.config);
+    }
+    for (const std::string& config : configs) {
+        std::vector<const Measure*> ms;
+        for (const Measure& m : done) {
+            if (m.point.config == config && m.ok && m.seconds > 0)
+                ms.push_back(&m);
+        }
+        if (ms.empty()) continue;
+        std::stable_sort(ms.begin(), ms.end(),
+            [](const Measure* a, const Measure* b) {
+            return a->point.size != b->point.size ?
+                a->point.size < b->point.size :
+                a->point.threads < b->point.threads;
+        });
+        for (size_t i = 0; i < ms.size(); ) {
+            const Measure* base = ms[i];
+            for (; i < ms.size() && ms[i]->point.size == base->point.size;
+                ++i) {
+                const Measure* m = ms[i];
+                const double speedup = base->seconds / m->seconds;
+                rows.push_back({m, "strong", speedup, speedup *
+                    base->point.threads / m->point.threads, 1});
+            }
+        }
+        const Measure* base = ms.front();
+        if (base->bytes == 0) continue;
+        const double baseRate = base->bytes / base->seconds;
+        const double basePerThread = double(base->bytes) /
+            base->point.threads;
+        std::vector<uint> counts;
+        for (const Measure* m : ms) counts.push_back(m->point.threads);
+        std::sort(counts.begin(), counts.end());
+        counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+        for (uint t : counts) {
+            const Measure* best = nullptr;
+            double bestDistance = 0;
+            for (const Measure* m : ms) {
+                if (m->point.threads != t || m->bytes == 0) continue;
+                const double d = std::abs(std::log(
+                    double(m->bytes) / t / basePerThread));
+                if (!best || d < bestDistance) {
+                    best = m;
+                    bestDistance = d;
+                }
+            }
+            if (!best) continue;
+            const double speedup = best->bytes / best->seconds / baseRate;
+            rows.push_back({best, "weak", speedup,
+                speedup * base->point.threads / t,
+                double(best->bytes) / t / basePerThread});
+        }
+    }
+
+    std::string summary = path;
+    if (summary.size() > 4 && summary.compare(summary.size() - 4, 4,
+        ".csv") == 0) summary.resize(summary.size() - 4);
+    summary += "-summary.csv";
+    std::ofstream sum(summary);
+    if (!sum.is_open()) throw FileException("Cannot write " + summary);
+    sum << "config,key,size,threads,scaling,time_s,speedup,efficiency," <<
+        "work_per_thread\n";
+    std::cout << "Scaling efficiency (" << summary << "):" << std::endl;
+    for (const Efficiency& r : rows) {
+        const Point& p = r.m->point;
+        sum << csvText(p.config) << ',' << p.key << ',' << p.size << ',' <<
+            p.threads << ',' << r.scaling << ',' << r.m->seconds << ',' <<
+            r.speedup << ',' << r.efficiency << ',' << r.work << '\n';
+        char line[160];
+        snprintf(line, sizeof(line),
+            "  %-16s %-6s %s %-7u %3u threads %10.3f s %7.2fx %6.1f%%",
+            p.config.c_str(), r.scaling.c_str(), p.key.c_str(), p.size,
+            p.threads, r.m->seconds, r.speedup, 100 * r.efficiency);
+        std::cout << line << std::endl;
+    }
+}
+
+std::vector<uint> ScalingStudy::parseList(const std::string& text) {
+    std::vector<uint> list;
+    std::stringstream ss(text);
+    for (std::string item; std::getline(ss, item, ','); ) {
+        char* end;
+        const unsigned long n = strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || n == 0 || n > UINT32_MAX)
+            return {};
+        list.push_back(n);
+    }
+    return list;
+}
\ No newline at end of file
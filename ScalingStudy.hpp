@@ -0,0 +1,75 @@
+#ifndef SCALINGSTUDY_H
+#define SCALINGSTUDY_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "Configuration.hpp"
+#include "Profiler.hpp"
+
+// End to end runs of configurations over a grid of sizes (samples, or
+// subdivision levels for spheres) and OpenMP thread counts. Every point of
+// the grid runs in a child process, so that its peak memory is its own;
+// its output files are measured through its manifest, then deleted. Stage
+// times are those of the profiler, in builds with NICE_PROFILE.
+// Results are a CSV with a row per point and stage, and a summary with the
+// strong scaling efficiency (same size, more threads) and the weak scaling
+// efficiency (same output bytes per thread).
+class ScalingStudy {
+    public:
+        struct Point {
+            std::string config;
+            std::string key;        // samples or subdivision
+            uint size, threads;
+            std::string prefix;     // of the outputs, with the out folder
+            std::string manifest;
+        };
+        struct Measure {
+            Point point;
+            bool ok;
+            double seconds;
+            size_t peakRSS;         // bytes
+            size_t jobs;
+            size_t bytes, files;    // written
+            std::vector<Profiler::Total> stages;
+        };
+        // Runs the configuration of a point, once its settings are applied;
+        // returns an exit status
+        typedef std::function<int(const Point&)> Runner;
+
+        // Default sizes are those of each config, and default thread counts
+        // the powers of two up to the available threads
+        ScalingStudy(const std::vector<uint>& sizes,
+            const std::vector<uint>& threads);
+
+        void run(ConfigManager& cm, const std::vector<std::string>& configs,
+            const Runner& runner);
+        // Measures into path, efficiencies into path-summary.csv
+        void write(const std::string& path) const;
+
+        const std::vector<Measure>& measures() const { return done; }
+
+        // Comma separated positive integers, empty if invalid
+        static std::vector<uint> parseList(const std::string& text);
+
+        class FileException;
+
+    private:
+        std::vector<uint> sizes, threads;
+        std::vector<Measure> done;
+
+        Measure measure(ConfigManager& cm, const Point& p,
+            const Runner& runner) const;
+};
+
+class ScalingStudy::FileException : public std::exception {
+    public:
+        FileException(std::string message) : message(message) {}
+        const char* what() { return message.c_str(); }
+    private:
+        std::string message;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "StripTriangulation.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // Points per strip; smaller point sets are triangulated in one piece
+    const uint STRIP_POINTS = 50000;
+    const uint MAX_STRIPS = 256;
+
+    inline double orient(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c) {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    // Circumcenter and radius; vertices should be given in a fixed order
+    // so that every strip computes the same values
+    inline void circle(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c,
+        glm::dvec2& center, double& radius) {
+        const glm::dvec2 ab = b - a, ac = c - a;
+        const double d = 2 * (ab.x * ac.y - ab.y * ac.x);
+        center = a + glm::dvec2(
+            ac.y * glm::dot(ab, ab) - ab.y * glm::dot(ac, ac),
+            ab.x * glm::dot(ac, ac) - ac.x * glm::dot(ab, ab)) / d;
+        radius = glm::length(center - a);
+    }
+}
+
+std::vector<uint> StripTriangulation::triangulate(
+    const std::vector<glm::dvec2>& points, const Backend& backend,
+    uint strips) {
+    if (strips == 0)
+        strips = std::min<size_t>(MAX_STRIPS, points.size() / STRIP_POINTS);
+    if (strips <= 1 || points.size() < 2 * strips) return backend(points);
+
+    // Points sorted by x, with repeated ones merged into the first
+    const uint n = points.size();
+    std::vector<uint> order(n);
+    for (uint i = 0; i < n; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&points](uint i, uint j) {
+        return points[i].x < points[j].x ||
+            (points[i].x == points[j].x && (points[i].y < points[j].y ||
+            (points[i].y == points[j].y && i < j)));
+    });
+    order.erase(std::unique(order.begin(), order.end(),
+        [&points](uint i, uint j) { return points[i] == points[j]; }),
+        order.end());
+    const uint m = order.size();
+    std::vector<glm::dvec2> sorted(m);
+    std::vector<double> xs(m);
+    glm::dvec2 lo = points[order[0]], hi = lo;
+    for (uint i = 0; i < m; ++i) {
+        sorted[i] = points[order[i]];
+        xs[i] = sorted[i].x;
+        lo = glm::min(lo, sorted[i]);
+        hi = glm::max(hi, sorted[i]);
+    }
+
+    // Strip bounds at quantiles of x, and a first margin of a few spacings
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> bound(strips + 1);
+    bound[0] = -inf;
+    bound[strips] = inf;
+    for (uint s = 1; s < strips; ++s) bound[s] = xs[uint64_t(s) * m / strips];
+    const double spacing = sqrt(std::max((hi.x - lo.x) * (hi.y - lo.y),
+        1e-300) / m);
+
+    // Columns of a few points each, with the y range of their points, to
+    // tell whether a circle may contain points beyond a strip's margin
+    const uint columns = std::max(1u, std::min(m / 16, 1u << 16));
+    const double width = std::max(hi.x - lo.x, 1e-300) / columns;
+    const auto column = [&](double x) {
+        return static_cast<uint>(std::min<double>(columns - 1,
+            std::max(0., (x - lo.x) / width)));
+    };
+    std::vector<double> ylo(columns, inf), yhi(columns, -inf);
+    for (uint i = 0; i < m; ++i) {
+        const uint k = column(xs[i]);
+        ylo[k] = std::min(ylo[k], sorted[i].y);
+        yhi[k] = std::max(yhi[k], sorted[i].y);
+    }
+    const auto reaches = [&](glm::dvec2 c, double r, double x0, double x1) {
+        x0 = std::max(x0, c.x - r);
+        x1 = std::min(x1, c.x + r);
+        if (x0 > x1) return false;
+        for (uint k = column(x0); k <= column(x1); ++k) {
+            if (ylo[k] > yhi[k]) continue;
+            const double bx0 = lo.x + k * width, bx1 = bx0 + width;
+            const double dx = std::max(0., std::max(bx0 - c.x, c.x - bx1));
+            const double dy = std::max(0., std::max(ylo[k] - c.y,
+                c.y - yhi[k]));
+            if (dx * dx + dy * dy < r * r) return true;
+        }
+        return false;
+    };
+
+    std::vector<std::vector<uint>> stripFaces(strips);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (uint s = 0; s < strips; ++s) {
+        std::vector<uint>& out = stripFaces[s];
+        for (double margin = 4 * spacing; ; margin *= 2) {
+            const double left = bound[s] - margin, right = bound[s+1] + margin;
+            const uint first = std::lower_bound(xs.begin(), xs.end(), left) -
+                xs.begin();
+            const uint last = std::upper_bound(xs.begin(), xs.end(), right) -
+                xs.begin();
+            const std::vector<glm::dvec2> local(sorted.begin() + first,
+                sorted.begin() + last);
+            const std::vector<uint> f = backend(local);
+
+            out.clear();
+            bool valid = true;
+            for (uint t = 0; t < f.size() / 3 && valid; ++t) {
+                uint v[3] = {first + f[3*t], first + f[3*t+1],
+                    first + f[3*t+2]};
+                std::rotate(v, std::min_element(v, v + 3), v + 3);
+                glm::dvec2 c;
+                double r;
+                circle(sorted[v[0]], sorted[v[1]], sorted[v[2]], c, r);
+                if (!(c.x >= bound[s] && c.x < bound[s+1])) continue;
+                if ((first > 0 && reaches(c, r, -inf, left)) ||
+                    (last < m && reaches(c, r, right, inf))) {
+                    valid = false;
+                    break;
+                }
+                out.insert(out.end(), {v[0], v[1], v[2]});
+            }
+            if (valid || (first == 0 && last == m)) break;
+        }
+    }
+
+    std::vector<uint> faces;
+    for (const auto& f : stripFaces) faces.insert(faces.end(), f.begin(), f.end());
+    if (!validate(sorted, faces)) faces = backend(sorted);
+    for (uint& v : faces) v = order[v];
+    return faces;
+}
+
+
+bool StripTriangulation::validate(const std::vector<glm::dvec2>& points,
+    const std::vector<uint>& faces, double tolerance) {
+    PROFILE_SCOPE("validate");
+    const uint n = points.size(), nf = faces.size() / 3;
+    if (n < 3 || nf == 0) return false;
+    for (uint v : faces) if (v >= n) return false;
+
+    // Faces around each vertex
+    std::vector<uint> start(n + 1, 0), incident(faces.size());
+    for (uint v : faces) ++start[v + 1];
+    for (uint i = 0; i < n; ++i) start[i + 1] += start[i];
+    {
+        std::vector<uint> fill(start.begin(), start.end() - 1);
+        for (uint k = 0; k < faces.size(); ++k)
+            incident[fill[faces[k]]++] = k / 3;
+    }
+
+    // Each vertex checks its fan: the edges (a, b) of its faces, in
+    // counterclockwise order, must chain into one cycle, or one path when
+    // it is on the boundary; next is the boundary edge leaving it
+    const uint none = -1;
+    std::vector<uint> next(n, none);
+    bool valid = true;
+    #pragma omp parallel reduction(&&:valid)
+    {
+    std::vector<std::pair<uint, uint>> fan;
+    #pragma omp for
+    for (uint v = 0; v < n; ++v) {
+        const uint deg = start[v + 1] - start[v];
+        if (deg == 0) {
+            valid = false;
+            continue;
+        }
+        fan.resize(deg);
+        for (uint j = 0; j < deg; ++j) {
+            const uint* f = &faces[3 * incident[start[v] + j]];
+            const uint k = (f[0] == v) ? 0 : ((f[1] == v) ? 1 : 2);
+            fan[j] = std::make_pair(f[(k+1)%3], f[(k+2)%3]);
+        }
+        std::sort(fan.begin(), fan.end());
+        const glm::dvec2 p = points[v];
+        uint open = 0, begin = fan[0].first;
+        for (uint j = 0; j < deg && valid; ++j) {
+            const uint a = fan[j].first, b = fan[j].second;
+            if ((j > 0 && fan[j-1].first == a) ||
+                orient(p, points[a], points[b]) <= 0) {
+                valid = false;
+                break;
+            }
+            // Face across (v, a), if any, ends with a
+            uint across = none;
+            for (const auto& g : fan) if (g.second == a) across = g.first;
+            if (across == none) {
+                ++open;
+                begin = a;
+                next[v] = a;
+                continue;
+            }
+            glm::dvec2 c;
+            double r;
+            circle(p, points[a], points[b], c, r);
+            if (glm::length(points[across] - c) < r * (1 - tolerance))
+                valid = false;
+        }
+        if (!valid || open > 1) {
+            valid = false;
+            continue;
+        }
+        // Walk the fan from its start: all faces, in one piece
+        uint steps = 0;
+        for (uint a = begin; steps <= deg; ++steps) {
+            auto it = std::lower_bound(fan.begin(), fan.end(),
+                std::make_pair(a, 0u));
+            if (it == fan.end() || it->first != a) break;
+            a = it->second;
+            if (a == begin) {
+                ++steps;
+                break;
+            }
+        }
+        if (steps != deg) valid = false;
+    }
+    }
+    if (!valid) return false;
+
+    // One convex boundary loop, enclosing the triangles once
+    double area = 0;
+    for (uint f = 0; f < nf; ++f) {
+        area += orient(points[faces[3*f]], points[faces[3*f+1]],
+            points[faces[3*f+2]]) / 2;
+    }
+    uint first = 0, boundary = 0;
+    while (first < n && next[first] == none) ++first;
+    for (uint v = 0; v < n; ++v) if (next[v] != none) ++boundary;
+    if (first == n) return false;
+    double enclosed = 0;
+    uint prev = first, v = next[first], steps = 1;
+    for (; v != first && v != none && steps <= boundary; ++steps) {
+        const uint w = next[v];
+        if (w == none) return false;
+        const double scale = glm::length(points[v] - points[prev]) *
+            glm::length(points[w] - points[v]);
+        if (orient(points[prev], points[v], points[w]) < -tolerance * scale)
+            return false;
+        enclosed += (points[prev].x * points[v].y -
+            points[v].x * points[prev].y) / 2;
+        prev = v;
+        v = w;
+    }
+    if (v != first || steps != boundary ||
+        orient(points[prev], points[first], points[next[first]]) <
+        -tolerance * glm::length(points[first] - points[prev]) *
+        glm::length(points[next[first]] - points[first])) return false;
+    enclosed += (points[prev].x * points[v].y -
+        points[v].x * points[prev].y) / 2;
+    return std::abs(area - enclosed) <= tolerance * std::abs(enclosed);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef STRIPTRIANGULATION_H
+#define STRIPTRIANGULATION_H
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+
+// Parallel Delaunay triangulation of large point sets in the plane, on top
+// of any serial triangulator. Points are cut into vertical strips of equal
+// count; each strip is triangulated together with its neighbors' points
+// within a margin, and keeps the triangles whose circumcenter it owns.
+// A kept triangle must have its circumcircle clear of the points beyond
+// the strip's margin (checked against the y range of the points in narrow
+// columns): then it is empty of all points, hence Delaunay. Otherwise the
+// strip is done again with twice the margin.
+// The stitched result is validated and, if that fails (e.g. cocircular
+// points split between strips), the whole set is triangulated serially.
+class StripTriangulation {
+    public:
+        // Counterclockwise triangles, as indices into the points
+        typedef std::function<std::vector<uint>(
+            const std::vector<glm::dvec2>&)> Backend;
+
+        // Strips default to one per 50000 points, so that the result does
+        // not depend on the thread count; repeated points are merged first,
+        // and their triangles use the first occurrence
+        static std::vector<uint> triangulate(
+            const std::vector<glm::dvec2>& points, const Backend& backend,
+            uint strips = 0);
+
+        // Delaunay triangulation of all the points: every vertex used and
+        // manifold, consistently oriented triangles, every edge locally
+        // Delaunay up to a relative tolerance, a single convex boundary
+        // enclosing the area of the triangles exactly once
+        static bool validate(const std::vector<glm::dvec2>& points,
+            const std::vector<uint>& faces, double tolerance = 1e-9);
+};
+
+#endif
\ No newline at end of file
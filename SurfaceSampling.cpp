@@ -0,0 +1,134 @@
+#include "SurfaceSampling.hpp"
+#include "ParametricSampler.hpp"
+#include "PoissonSampler.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <sstream>
+
+SurfaceSampling::Method SurfaceSampling::method(const std::string& name) {
+    if (name == "random") return RANDOM;
+    if (name == "poisson") return POISSON;
+    if (name == "elimination") return ELIMINATION;
+    if (name == "sobol") return SOBOL;
+    if (name == "halton") return HALTON;
+    throw UnknownMethodException();
+}
+
+glm::dmat2 SurfaceSampling::parseMetric(const std::string& text) {
+    double m[3];
+    std::stringstream ss(text);
+    for (uint k = 0; k < 3; ++k) {
+        std::string item;
+        if (!std::getline(ss, item, ',')) throw InvalidMetricException();
+        try {
+            m[k] = std::stod(item);
+        }
+        catch (std::exception& e) {
+            throw InvalidMetricException();
+        }
+    }
+    if (!ss.eof() || !(m[0] > 0) || !(m[0] * m[2] - m[1] * m[1] > 0))
+        throw InvalidMetricException();
+    return glm::dmat2(m[0], m[1], m[1], m[2]);
+}
+
+SurfaceSampling::Metric SurfaceSampling::metric(const Evaluator& surface,
+    double anisotropy, const Options& options) {
+    if (options.constantMetric) {
+        const glm::dmat2 m = options.metric;
+        return [m](double u, double v) { return m; };
+    }
+    return [surface, anisotropy](double u, double v) {
+        return surface(u, v).anisotropicMetric(anisotropy);
+    };
+}
+
+std::vector<glm::dvec2> SurfaceSampling::points(const Metric& metric,
+    uint samples, Method method, PlaneSampling::Periodicity periodicity) {
+    PROFILE_SCOPE("sampling");
+    const ParametricSampler area([&metric](double u, double v) {
+        return sqrt(std::max(0., glm::determinant(metric(u, v))));
+    });
+    const bool periodic = (periodicity != PlaneSampling::SQUARE);
+    const uint borderSamples = 4 * std::floor(sqrt(samples));
+    const LowDiscrepancy* sequence = nullptr;
+    if (method == SOBOL || method == HALTON) {
+        sequence = new LowDiscrepancy(method == SOBOL ?
+            LowDiscrepancy::SOBOL : LowDiscrepancy::HALTON,
+            RandPoint::current().split());
+    }
+    if ((method == RANDOM || sequence) && !periodic) {
+        const std::vector<glm::dvec2> result =
+            area.uniformSampling(samples, true, borderSamples, sequence);
+        delete sequence;
+        return result;
+    }
+
+    // Otherwise the inside is filled around an evenly spaced border
+    const PoissonSampler poisson(metric, area, 64, periodic,
+        periodicity == PlaneSampling::TORUS);
+    const double spacing = sqrt(2 * poisson.area() / (sqrt(3) * samples));
+    std::vector<glm::dvec2> fixed = border(metric, spacing, periodicity);
+    if (method == POISSON) {
+        return poisson.dartThrowing(poisson.radius(samples), fixed);
+    }
+    if (method == ELIMINATION) return poisson.eliminate(samples, fixed);
+    if (fixed.size() < samples) {
+        const std::vector<glm::dvec2> inner = area.uniformSampling(
+            samples - fixed.size(), false, 0, sequence);
+        fixed.insert(fixed.end(), inner.begin(), inner.end());
+    }
+    delete sequence;
+    return fixed;
+}
+
+PlaneSampling SurfaceSampling::plane(const Metric& metric, uint samples,
+    const Options& options, PlaneSampling::Periodicity periodicity) {
+    PlaneSampling plane(points(metric, samples, options.method, periodicity),
+        periodicity, options.cacheFolder);
+    plane.flip(metric);
+    if (!options.planePath.empty()) plane.print(options.planePath);
+    return plane;
+}
+
+std::vector<glm::dvec2> SurfaceSampling::border(const Metric& metric,
+    double spacing, PlaneSampling::Periodicity periodicity) {
+    std::vector<glm::dvec2> points;
+    if (periodicity == PlaneSampling::SQUARE) {
+        points = {glm::dvec2(0,0), glm::dvec2(1,0), glm::dvec2(1,1),
+            glm::dvec2(0,1)};
+    }
+    // Opposite edges get the same parameters, so that periodic surfaces
+    // match when triangulated on the square; the arc length is averaged
+    // between them
+    const uint steps = 256;
+    for (uint dir = 0; dir < 2; ++dir) {
+        if ((dir == 0 && periodicity == PlaneSampling::TORUS) ||
+            (dir == 1 && periodicity != PlaneSampling::SQUARE)) continue;
+        std::vector<double> length(steps + 1, 0);
+        for (uint k = 0; k < steps; ++k) {
+            const double t = (k + .5) / steps;
+            const glm::dmat2 g0 = dir ? metric(0, t) : metric(t, 0);
+            const glm::dmat2 g1 = dir ? metric(1, t) : metric(t, 1);
+            const double ds = (sqrt(g0[dir][dir]) + sqrt(g1[dir][dir])) / 2;
+            length[k+1] = length[k] + ds / steps;
+        }
+        // Points at the middle of equal arcs, or at their ends around the
+        // cylinder, where the edge is a closed loop
+        const bool loop = (periodicity == PlaneSampling::CYLINDER);
+        const uint m = loop ?
+            std::max(3., std::round(length[steps] / spacing)) :
+            std::max(1., std::round(length[steps] / spacing) - 1);
+        for (uint i = 0; i < m; ++i) {
+            const double target = (i + (loop ? 0 : .5)) / m * length[steps];
+            const uint k = std::upper_bound(length.begin() + 1,
+                length.end() - 1, target) - length.begin() - 1;
+            const double seg = length[k+1] - length[k];
+            const double t = (k + ((seg > 0) ? (target - length[k]) / seg :
+                .5)) / steps;
+            points.push_back(dir ? glm::dvec2(0, t) : glm::dvec2(t, 0));
+            points.push_back(dir ? glm::dvec2(1, t) : glm::dvec2(t, 1));
+        }
+    }
+    return points;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef SURFACESAMPLING_H
+#define SURFACESAMPLING_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "DifferentialQuantities.hpp"
+#include "PlaneSampling.hpp"
+
+// Point sets in the parametric square of an analytic surface, ready to be
+// triangulated by PlaneSampling: corners, border points, inner points.
+// Periodic sides of the domain get no corners or border points.
+// Points follow a metric tensor field M(u,v): density is proportional to
+// sqrt(det M), and the blue noise methods space points evenly in M, so
+// that an anisotropic M gives stretched, oriented triangles.
+class SurfaceSampling {
+    public:
+        enum Method {
+            RANDOM,         // i.i.d. with density sqrt(det M)
+            POISSON,        // dart throwing, about the requested count
+            ELIMINATION,    // weighted sample elimination, exact count
+            SOBOL,          // scrambled low-discrepancy sequences, warped
+            HALTON          // by the density
+        };
+        typedef std::function<DifferentialQuantities(double, double)>
+            Evaluator;
+        typedef std::function<glm::dmat2(double, double)> Metric;
+
+        // Sampling parameters besides the anisotropy
+        struct Options {
+            Options() : method(RANDOM), constantMetric(false), metric(1) {}
+            Method method;
+            bool constantMetric;    // use metric instead of the surface's
+            glm::dmat2 metric;
+            std::string planePath;  // export of the triangulation, if set
+            std::string cacheFolder;    // of triangulations, if set
+        };
+
+        static Method method(const std::string& name);
+        // Symmetric positive definite tensor from "a,b,c", as [[a b] [b c]]
+        static glm::dmat2 parseMetric(const std::string& text);
+
+        // First fundamental form of the surface with lengths along the
+        // direction of largest curvature scaled by the anisotropy, or the
+        // constant metric of the options
+        static Metric metric(const Evaluator& surface, double anisotropy,
+            const Options& options = Options());
+        static std::vector<glm::dvec2> points(const Metric& metric,
+            uint samples, Method method = RANDOM,
+            PlaneSampling::Periodicity periodicity = PlaneSampling::SQUARE);
+        // Triangulated points, with edges flipped towards the Delaunay
+        // triangulation in the metric
+        static PlaneSampling plane(const Metric& metric, uint samples,
+            const Options& options = Options(),
+            PlaneSampling::Periodicity periodicity = PlaneSampling::SQUARE);
+
+        class UnknownMethodException;
+        class InvalidMetricException;
+
+    private:
+        // Corners and evenly spaced points on the non-periodic edges
+        static std::vector<glm::dvec2> border(const Metric& metric,
+            double spacing, PlaneSampling::Periodicity periodicity);
+};
+
+class SurfaceSampling::UnknownMethodException : public std::exception {
+    public: const char* what() { return "Unknown sampling method"; }
+};
+
+class SurfaceSampling::InvalidMetricException : public std::exception {
+    public: const char* what() {
+        return "Metric must be three numbers a,b,c with a > 0, ac > b^2";
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "Torus.hpp"
+#include "MeshStream.hpp"
+#include "SurfaceSampling.hpp"
 
 Torus::Torus(
         uint samples,   // samples in toroidal direction
@@ -14,14 +16,8 @@ Torus::Torus(
 
     // Pre-computation for sampling in poloidal direction
     double phiMax = 0;
-    uint count = 0;
     const double vStep = quad ? uStep : SQRT3_2 * uStep;
-    // rescale to [0, 1]
-    while (phiMax < TWOPI || count % 2) { 
-        phiMax += TWOPI * vStep * (rRatio + cos(phiMax));
-        ++count;
-    }
-    const uint vSamples = count;
+    const uint vSamples = poloidalSamples(rRatio, vStep, phiMax);
     const uint uvSamples = uSamples * vSamples;
 
     name = "RegularTorus";
@@ -38,17 +34,13 @@ Torus::Torus(
             if (uu < 0) uu += 1.;
             assert(uu >= 0 && vv >= 0 && uu <= 1 && vv <= 1);
             
-            const uint index = placeVertex(uu, vv);
+            placeVertex(uu, vv);
 
             // Add faces
-            const uint us = (u+uSamples-off)%uSamples;
-            uint a = index;
-            uint b = (u+1)%uSamples+v*uSamples;
-            uint c = ((u+1-off)%uSamples+(v+1)*uSamples)%uvSamples;
-            uint d = ((us+uSamples)%uSamples+(v+1)*uSamples)%uvSamples;
-
-            addFace(a, b, c);
-            addFace(a, c, d);
+            uint f[6];
+            cellFaces(u, v, uSamples, vSamples, quad, f);
+            addFace(f[0], f[1], f[2]);
+            addFace(f[3], f[4], f[5]);
         }
         phi += TWOPI * vStep * (rRatio + cos(phi));
     }
@@ -56,6 +48,71 @@ Torus::Torus(
 }
 
 
+void Torus::stream(std::string path, std::string name, uint samples,
+    double rOuter, double rInner, bool quad) {
+    // Same sampling as the regular constructor
+    const double rRatio = rOuter / rInner;
+    const uint uSamples = samples;
+    const double uStep = 1.0 / static_cast<double>(uSamples);
+    double phiMax = 0;
+    const double vStep = quad ? uStep : SQRT3_2 * uStep;
+    const uint vSamples = poloidalSamples(rRatio, vStep, phiMax);
+    const uint uvSamples = uSamples * vSamples;
+
+    MeshStream out(path, name, uvSamples, 2*uvSamples);
+
+    // Vertices, one row at a time
+    double att[MeshStream::attributes];
+    double phi = 0;
+    for (uint v = 0; v < vSamples; ++v) {
+        for (uint u = 0; u < uSamples; ++u) {
+            uint off = quad ? 0 : (v%2);
+            double uu = (u - off*.5) * uStep;
+            if (uu < 0) uu += 1.;
+            evaluate(rOuter, rInner, uu, phi / phiMax, att);
+            out.vertex(att);
+        }
+        phi += TWOPI * vStep * (rRatio + cos(phi));
+    }
+    // Faces follow from the grid indices
+    for (uint v = 0; v < vSamples; ++v) {
+        for (uint u = 0; u < uSamples; ++u) {
+            uint f[6];
+            cellFaces(u, v, uSamples, vSamples, quad, f);
+            out.face(f[0], f[1], f[2]);
+            out.face(f[3], f[4], f[5]);
+        }
+    }
+    out.close();
+}
+
+
+uint Torus::poloidalSamples(double rRatio, double vStep, double& phiMax) {
+    phiMax = 0;
+    uint count = 0;
+    // rescale to [0, 1]
+    while (phiMax < TWOPI || count % 2) { 
+        phiMax += TWOPI * vStep * (rRatio + cos(phiMax));
+        ++count;
+    }
+    return count;
+}
+
+
+void Torus::cellFaces(uint u, uint v, uint uSamples, uint vSamples,
+    bool quad, uint* f) {
+    const uint uvSamples = uSamples * vSamples;
+    const uint off = quad ? 0 : (v%2);
+    const uint us = (u+uSamples-off)%uSamples;
+    uint a = u+v*uSamples;
+    uint b = (u+1)%uSamples+v*uSamples;
+    uint c = ((u+1-off)%uSamples+(v+1)*uSamples)%uvSamples;
+    uint d = ((us+uSamples)%uSamples+(v+1)*uSamples)%uvSamples;
+    f[0] = a; f[1] = b; f[2] = c;
+    f[3] = a; f[4] = c; f[5] = d;
+}
+
+
 Torus::Torus(
         std::string path,
         double rOuter,
@@ -92,34 +149,17 @@ Torus::Torus(const PlaneSampling& plane, double rOuter, double rInner) :
     const uint pv = plane.vertNum(), pf = plane.faceNum();
     reserveSpace(pv, pf);
 
-    // Place vertices
-    std::vector<unsigned long> boundary;   // boundary vertices on plane
-    std::vector<unsigned long> newId;   // vertex index on the surface
-    newId.reserve(pv);
-    
-    for (unsigned long int i = 0; i < pv; ++i) {
-        const double ui = plane.cAttrib(i, 0), vi = plane.cAttrib(i, 1);
-        const double mui = ui - floor(ui), mvi = vi - floor(vi);
-        // Boundary vertex duplicate checking
-        if (mui == 0. || mvi == 0.) {
-            bool duplicate = false;
-            for (unsigned long j : boundary) {
-                const double uj = plane.cAttrib(j, 0), vj = plane.cAttrib(j, 1);
-                const double muj = uj - floor(uj), mvj = vj - floor(vj);
-                if (mui == muj && mvi == mvj) {
-                    duplicate = true;
-                    newId.push_back(newId.at(j));
-                    break;
-                }
-            }
-            if (!duplicate) {
-                boundary.push_back(i);
-                newId.push_back(placeVertex(ui, vi));
-            }
-        }
-        else {
-            newId.push_back(placeVertex(ui, vi));
-        }
+    // Place vertices, once for each group of points which coincide
+    // around the seams (periodic in both directions); only planes
+    // triangulated on the square have such groups
+    const double period[2] = {1, 1};
+    const std::vector<uint> rep = weldMap(plane.verts.data(), pv, 2, 2,
+        WELD_TOLERANCE, period);
+    std::vector<uint> newId(pv);
+    for (uint i = 0; i < pv; ++i) {
+        newId[i] = (rep[i] == i) ?
+            placeVertex(plane.cAttrib(i, 0), plane.cAttrib(i, 1)) :
+            newId[rep[i]];
     }
 
     // Write faces w/ substitutions
@@ -134,42 +174,51 @@ Torus::Torus(const PlaneSampling& plane, double rOuter, double rInner) :
 }
 
 
-Torus::Torus(uint samples, double rOuter, double rInner, double aniso) :
+Torus::Torus(uint samples, double rOuter, double rInner, double aniso,
+    const SurfaceSampling::Options& options) :
     /*
-    This monstrosity creates a simple "base" uniform mesh, samples it,
-    triangulates it, and finally calls the PlaneSampling constructor.
-    Anisotropy is currently ignored.
+    Samples the parameter domain following a metric aligned with the
+    principal directions, triangulates it with the seams closed, and calls
+    the PlaneSampling constructor.
     */
-    Torus(PlaneSampling(
-        Torus(16, rOuter, rInner).uniformSampling(
-            samples, true, 4 * std::floor(sqrt(samples)))
-        ), rOuter, rInner
+    Torus(SurfaceSampling::plane(
+        SurfaceSampling::metric([=](double u, double v) {
+            return diffEvaluate(rOuter, rInner, u, v);
+        }, aniso, options), samples, options,
+        PlaneSampling::TORUS), rOuter, rInner
     ) {}
 
 
 void Torus::replaceVertex(uint index, double u, double v) {
+    double att[MeshStream::attributes];
+    evaluate(rOuter, rInner, u, v, att);
+    for (uint k = 0; k < MeshStream::attributes; ++k) attrib(index, k) = att[k];
+}
+
+void Torus::evaluate(double rOuter, double rInner, double u, double v,
+    double* att) {
     const double sinu = sin(TWOPI * u);
     const double cosu = cos(TWOPI * u);
     const double sinv = sin(TWOPI * v);
     const double cosv = cos(TWOPI * v);
     
-    attrib(index, Attribute::X) = cosu * (rOuter + rInner * cosv);
-    attrib(index, Attribute::Y) = sinu * (rOuter + rInner * cosv);
-    attrib(index, Attribute::Z) = rInner * sinv;
+    att[X] = cosu * (rOuter + rInner * cosv);
+    att[Y] = sinu * (rOuter + rInner * cosv);
+    att[Z] = rInner * sinv;
 
     // Normals
-    attrib(index, Attribute::NX) = cosu * cosv;
-    attrib(index, Attribute::NY) = sinu * cosv;
-    attrib(index, Attribute::NZ) = sinv;
+    att[NX] = cosu * cosv;
+    att[NY] = sinu * cosv;
+    att[NZ] = sinv;
 
     // Parametric coordinates
-    attrib(index, Attribute::U) = u;
-    attrib(index, Attribute::V) = v;
+    att[U] = u;
+    att[V] = v;
 
     // Curvature
-    attrib(index, Attribute::K) = cosv /
+    att[K] = cosv /
         (rInner * (rOuter + rInner * cosv));
-    attrib(index, Attribute::H) = (rOuter + 2 * rInner * cosv) /
+    att[H] = (rOuter + 2 * rInner * cosv) /
         (2 * rInner * (rOuter + rInner * cosv));
 }
 
@@ -181,6 +230,11 @@ uint Torus::placeVertex(double u, double v) {
 
 
 DifferentialQuantities Torus::diffEvaluate(double u, double v) const {
+    return diffEvaluate(rOuter, rInner, u, v);
+}
+
+DifferentialQuantities Torus::diffEvaluate(double rOuter, double rInner,
+    double u, double v) {
     const double sinu = sin(TWOPI * u);
     const double cosu = cos(TWOPI * u);
     const double sinv = sin(TWOPI * v);
@@ -5,6 +5,7 @@
 #include "PlaneSampling.hpp"
 #include "Constants.hpp"
 #include "DifferentialQuantities.hpp"
+#include "SurfaceSampling.hpp"
 
 class Torus : public Mesh {
     public:
@@ -28,12 +29,35 @@ class Torus : public Mesh {
             uint samples,
             double rOuter,
             double rInner,
-            double anisotropy
+            double anisotropy,
+            const SurfaceSampling::Options& options =
+                SurfaceSampling::Options()
         );
 
         DifferentialQuantities diffEvaluate(double u, double v) const override;
 
+        // Write a regular torus directly to a PLY file, row by row
+        static void stream(
+            std::string path,
+            std::string name,
+            uint samples,
+            double rOuter,
+            double rInner,
+            bool quad = false
+        );
+
     private:
+        // Number of rows in poloidal direction and total angle they span
+        static uint poloidalSamples(double rRatio, double vStep,
+            double& phiMax);
+        // Indices of the two faces of the grid cell at (u,v)
+        static void cellFaces(uint u, uint v, uint uSamples, uint vSamples,
+            bool quad, uint* f);
+        // All vertex attributes at (u,v), in storage order
+        static void evaluate(double rOuter, double rInner, double u, double v,
+            double* att);
+        static DifferentialQuantities diffEvaluate(double rOuter,
+            double rInner, double u, double v);
         const double rInner, rOuter;
         uint placeVertex(double u, double v);
         void replaceVertex(uint i, double u, double v);
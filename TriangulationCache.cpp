@@ -0,0 +1,166 @@
+#include "TriangulationCache.hpp"
+#include "RandPoint.hpp"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[4] = {'N', 'M', 'T', 'R'};
+    const uint32_t VERSION = 1;
+
+    struct Entry {
+        TriangulationCache::Key key;
+        std::vector<uint> faces;
+    };
+
+    std::mutex mtx;
+    size_t memory = size_t(256) << 20;
+    size_t used = 0;
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> byHash;
+
+    inline size_t bytes(const Entry& e) {
+        return e.faces.size() * sizeof(uint) + sizeof(Entry);
+    }
+
+    std::string path(const std::string& folder, uint64_t hash) {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx",
+            static_cast<unsigned long long>(hash));
+        return folder + (folder.back() == '/' ? "" : "/") + name + ".tri";
+    }
+
+    // Callers hold the lock
+    void insert(const TriangulationCache::Key& key,
+        const std::vector<uint>& faces) {
+        if (byHash.count(key.hash)) return;
+        Entry e = {key, faces};
+        if (bytes(e) > memory) return;
+        used += bytes(e);
+        entries.push_front(std::move(e));
+        byHash[key.hash] = entries.begin();
+        while (used > memory) {
+            used -= bytes(entries.back());
+            byHash.erase(entries.back().key.hash);
+            entries.pop_back();
+        }
+    }
+
+    // Binary file: magic, version, hash, check, point count, byHash count,
+    // then the indices as 32 bit integers in host order
+    bool readFile(const std::string& folder, const TriangulationCache::Key& key,
+        std::vector<uint>& faces) {
+        std::ifstream in(path(folder, key.hash), std::ios::binary);
+        if (!in.is_open()) return false;
+        char magic[4];
+        uint32_t version;
+        uint64_t header[4];
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!in || std::memcmp(magic, MAGIC, 4) || version != VERSION ||
+            header[0] != key.hash || header[1] != key.check ||
+            header[2] != key.points) return false;
+        // A triangulation of n points has at most 2n faces
+        if (header[3] % 3 != 0 || header[3] > 6 * key.points) return false;
+        std::vector<uint32_t> data(header[3]);
+        in.read(reinterpret_cast<char*>(data.data()),
+            data.size() * sizeof(uint32_t));
+        if (!in) return false;
+        // Truncated or edited files are ignored, and triangulated again
+        for (const uint32_t i : data) {
+            if (i >= key.points) return false;
+        }
+        faces.assign(data.begin(), data.end());
+        return true;
+    }
+
+    void writeFile(const std::string& folder,
+        const TriangulationCache::Key& key, const std::vector<uint>& faces) {
+        // Written aside, then renamed, so that readers never see a part
+        const std::string target = path(folder, key.hash);
+        const std::string temp = target + "." + std::to_string(getpid()) +
+            "." + std::to_string(
+            std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::ofstream out(temp, std::ios::binary);
+        if (!out.is_open()) return;
+        const uint64_t header[4] = {key.hash, key.check, key.points,
+            faces.size()};
+        const std::vector<uint32_t> data(faces.begin(), faces.end());
+        out.write(MAGIC, 4);
+        out.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(data.data()),
+            data.size() * sizeof(uint32_t));
+        out.close();
+        if (!out || std::rename(temp.c_str(), target.c_str()))
+            std::remove(temp.c_str());
+    }
+}
+
+TriangulationCache::Key TriangulationCache::key(
+    const std::vector<glm::dvec2>& points, const std::string& settings) {
+    Key k = {RandPoint::hash(settings), RandPoint::mix(RandPoint::hash(settings)
+        ^ 0x5851F42D4C957F2Dull), points.size()};
+    for (const auto& p : points) {
+        for (uint d = 0; d < 2; ++d) {
+            uint64_t bits;
+            std::memcpy(&bits, &p[d], sizeof(bits));
+            k.hash = RandPoint::mix(k.hash ^ bits);
+            k.check = (k.check ^ bits) * 0x100000001B3ull + 0x9E3779B9ull;
+        }
+    }
+    k.check = RandPoint::mix(k.check ^ k.points);
+    return k;
+}
+
+bool TriangulationCache::find(const Key& key, std::vector<uint>& faces,
+    const std::string& folder) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto it = byHash.find(key.hash);
+        if (it != byHash.end()) {
+            if (it->second->key.check != key.check ||
+                it->second->key.points != key.points) return false;
+            entries.splice(entries.begin(), entries, it->second);
+            faces = it->second->faces;
+            return true;
+        }
+    }
+    if (folder.empty() || !readFile(folder, key, faces)) return false;
+    std::lock_guard<std::mutex> lock(mtx);
+    insert(key, faces);
+    return true;
+}
+
+void TriangulationCache::store(const Key& key,
+    const std::vector<uint>& faces, const std::string& folder) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        insert(key, faces);
+    }
+    if (!folder.empty()) writeFile(folder, key, faces);
+}
+
+void TriangulationCache::configure(size_t budget) {
+    std::lock_guard<std::mutex> lock(mtx);
+    memory = budget;
+    while (used > memory) {
+        used -= bytes(entries.back());
+        byHash.erase(entries.back().key.hash);
+        entries.pop_back();
+    }
+}
+
+void TriangulationCache::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.clear();
+    byHash.clear();
+    used = 0;
+}
\ No newline at end of file
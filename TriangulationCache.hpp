@@ -0,0 +1,37 @@
+#ifndef TRIANGULATIONCACHE_H
+#define TRIANGULATIONCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+
+// Triangulations of point sets, addressed by their content: a hash of the
+// points' bits and of the triangulator settings. Results are kept in
+// memory (least recently used first out) and, when a folder is given, in
+// binary files there, so later runs on the same points skip the
+// triangulation. A second, independent hash is stored with each entry and
+// checked on lookup. Safe to use from several threads.
+class TriangulationCache {
+    public:
+        struct Key {
+            uint64_t hash, check;
+            uint64_t points;
+        };
+
+        static Key key(const std::vector<glm::dvec2>& points,
+            const std::string& settings);
+        // Faces of a cached triangulation; false if absent. Files are read
+        // from and written to folder, unless it is empty.
+        static bool find(const Key& key, std::vector<uint>& faces,
+            const std::string& folder = "");
+        static void store(const Key& key, const std::vector<uint>& faces,
+            const std::string& folder = "");
+
+        // Memory budget in bytes, shared by the whole process
+        static void configure(size_t memory);
+        static void clear();
+};
+
+#endif
\ No newline at end of file
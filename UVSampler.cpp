@@ -0,0 +1,49 @@
+#include "UVSampler.hpp"
+
+void UVSampler::sampleUV(uint n, glm::dvec2* out) const {
+    const uint64_t key = RandPoint::current().split();
+    #pragma omp parallel for
+    for (uint i = 0; i < n; ++i) {
+        RandPoint::Stream rng(key, i);
+        out[i] = sampleUV(rng);
+    }
+}
+
+std::vector<glm::dvec2> UVSampler::uniformSampling(uint samples,
+    bool corners, uint border, const LowDiscrepancy* sequence) const {
+    std::vector<glm::dvec2> newVerts;
+    newVerts.reserve(samples);
+    // Add corner vertices first
+    if (corners) {
+        newVerts.push_back(glm::dvec2(0,0));
+        newVerts.push_back(glm::dvec2(1,0));
+        newVerts.push_back(glm::dvec2(1,1));
+        newVerts.push_back(glm::dvec2(0,1));
+    }
+    // Then, add border vertices (in groups of 4); a sequence is scrambled
+    // differently for the border, so that inner points start at index 0
+    const LowDiscrepancy* borderSequence = sequence ?
+        new LowDiscrepancy(sequence->rescrambled()) : nullptr;
+    for (uint i = newVerts.size(), k = 0; i < border; i+=4, ++k) {
+        const auto rand = borderSequence ?
+            warp(borderSequence->point(k)) : sampleUV();
+        newVerts.push_back(glm::dvec2(rand.x,0));
+        newVerts.push_back(glm::dvec2(1,rand.y));
+        newVerts.push_back(glm::dvec2(rand.x,1));
+        newVerts.push_back(glm::dvec2(0,rand.y));
+    }
+    delete borderSequence;
+    // Finally, add inner vertices
+    const uint inner = newVerts.size();
+    if (inner < samples) {
+        newVerts.resize(samples);
+        if (sequence) {
+            glm::dvec2* out = &newVerts[inner];
+            #pragma omp parallel for
+            for (uint i = 0; i < samples - inner; ++i)
+                out[i] = warp(sequence->point(i));
+        }
+        else sampleUV(samples - inner, &newVerts[inner]);
+    }
+    return newVerts;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef UVSAMPLER_H
+#define UVSAMPLER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "RandPoint.hpp"
+#include "LowDiscrepancy.hpp"
+
+// Random points of the unit parametric square, distributed uniformly on the
+// surface it parametrizes
+class UVSampler {
+    public:
+        virtual ~UVSampler() {}
+
+        virtual glm::dvec2 sampleUV(
+            RandPoint::Stream& rng = RandPoint::current()) const = 0;
+        // Fill a preallocated buffer with n samples, one stream per sample
+        virtual void sampleUV(uint n, glm::dvec2* out) const;
+        // Map of the unit square onto the domain, with uniform surface
+        // density for uniform input
+        virtual glm::dvec2 warp(glm::dvec2 p) const = 0;
+
+        // Point set for a PlaneSampling: corners, border points in groups
+        // of 4, then inner points up to the total count. Points are random,
+        // or warped from a low-discrepancy sequence if one is given.
+        std::vector<glm::dvec2> uniformSampling(uint samples,
+            bool corners = true, uint border = 0,
+            const LowDiscrepancy* sequence = nullptr) const;
+
+        virtual size_t byteSize() const = 0;
+};
+
+#endif
\ No newline at end of file
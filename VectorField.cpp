@@ -1,35 +1,37 @@
 #include "VectorField.hpp"
+#include "ChunkedOutput.hpp"
+#include "CompressedStream.hpp"
+#include "Profiler.hpp"
 
 VectorField::VectorField(Mesh* m, bool onFaces) :
-    mesh(m), samples(onFaces ? m->faceNum() : m->vertNum()) {
-    for (int i = 0; i < 3; ++i) {
-		components[i] = new ScalarField(m, 0, onFaces);
-	}
+    mesh(m), samples(onFaces ? m->faceNum() : m->vertNum()),
+    faceField(onFaces) {
+    values = new double[3 * samples];
 }
 
 VectorField::~VectorField() {
-    for (int i = 0; i < 3; ++i) {
-		delete components[i];
-	}
+    delete[] values;
 }
 
 void VectorField::setValue(glm::dvec3 value, uint index) {
-	components[0]->setValue(value.x, index);
-	components[1]->setValue(value.y, index);
-	components[2]->setValue(value.z, index);
+	if (index >= samples) { throw ScalarField::TooManyValuesException(); }
+	values[3*index+0] = value.x;
+	values[3*index+1] = value.y;
+	values[3*index+2] = value.z;
 }
 
 glm::dvec3 VectorField::getValue(uint index) const {
 	return glm::dvec3(
-		components[0]->getValue(index),
-		components[1]->getValue(index),
-		components[2]->getValue(index)
+		values[3*index+0],
+		values[3*index+1],
+		values[3*index+2]
 	);
 }
 
 void VectorField::write(std::string path, bool header) const {
+    PROFILE_SCOPE("writeVectorField");
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw Mesh::FileOpenException();
 
     // Write header
@@ -37,29 +39,32 @@ void VectorField::write(std::string path, bool header) const {
         file << "VECTOR_FIELD " << samples << std::endl;
     }
     // Write values
-    for (uint i = 0; i < samples; ++i) {
+    ChunkedOutput::write(file, samples, [&](std::ostream& out, size_t i) {
 		const glm::dvec3 v = getValue(i);
-        file << std::setprecision(DPRECIS) << v.x << " "
+        out << std::setprecision(DPRECIS) << v.x << " "
             << std::setprecision(DPRECIS) << v.y << " "
-            << std::setprecision(DPRECIS) << v.z << std::endl;
-    }
+            << std::setprecision(DPRECIS) << v.z << '\n';
+    });
 
     // Close file
     file.close();
+    if (!file) throw Mesh::FileWriteException();
 }
 
 void VectorField::write2d(std::string path) const {
+    PROFILE_SCOPE("writeVectorField");
     // Open file
-    std::ofstream file(path);
+    OutFile file(path);
     if (!file.is_open()) throw Mesh::FileOpenException();
 
     // Write verts
-    for (uint i = 0; i < samples; ++i) {
+    ChunkedOutput::write(file, samples, [&](std::ostream& out, size_t i) {
 		const glm::dvec3 v = getValue(i);
-        file << std::setprecision(DPRECIS) << v.x << " "
-            << std::setprecision(DPRECIS) << v.y << std::endl;
-    }
+        out << std::setprecision(DPRECIS) << v.x << " "
+            << std::setprecision(DPRECIS) << v.y << '\n';
+    });
 
     // Close file
     file.close();
+    if (!file) throw Mesh::FileWriteException();
 }
\ No newline at end of file
@@ -12,11 +12,17 @@ class VectorField {
         glm::dvec3 getValue(uint i) const;
         void write(std::string path, bool header=false) const;
         void write2d(std::string path) const;
+        inline uint size() const { return samples; }
+        inline size_t byteSize() const {
+            return 3 * samples * sizeof(double);
+        }
+        inline bool onFaces() const { return faceField; }
 
     private:
         const Mesh* mesh;
         const uint samples;
-        ScalarField* components[3];
+        const bool faceField;
+        double* values;             // interleaved x, y, z
         uint pair(uint x, uint y) const;
 };
 
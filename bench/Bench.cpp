@@ -0,0 +1,187 @@
+#include "Bench.hpp"
+#include "AllocationTracker.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <omp.h>
+
+namespace {
+    double milliseconds() {
+        using namespace std::chrono;
+        return duration<double, std::milli>(
+            steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::string quoted(const std::string& s) {
+        std::string q = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') q += '\\';
+            q += c;
+        }
+        return q + '"';
+    }
+
+    std::string timestamp() {
+        char text[32];
+        const time_t t = time(0);
+        strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+        return text;
+    }
+}
+
+
+bool Bench::selected(const std::string& name) const {
+    return name.find(options.filter) != std::string::npos;
+}
+
+void Bench::printHeader() const {
+    char header[192];
+    snprintf(header, sizeof(header), "%-28s %9s %10s %11s %11s %11s %12s%s",
+        "case", "size", "items", "median ms", "p10 ms", "p90 ms", "items/s",
+        AllocationTracker::enabled() ? "  allocs/item" : "");
+    std::cout << header << std::endl;
+}
+
+void Bench::run(const std::string& name, size_t size, const Case& c) {
+    if (!selected(name)) return;
+    Result r;
+    r.allocations = UINT64_MAX;
+    size_t items = 0;
+    auto once = [&](bool timed) {
+        if (c.setup) c.setup();
+        const AllocationTracker::Stages before = AllocationTracker::stages();
+        AllocationTracker::resetPeak();
+        const AllocationTracker::Count start = AllocationTracker::total();
+        const double t0 = milliseconds();
+        items = c.body();
+        const double time = milliseconds() - t0;
+        const AllocationTracker::Count end = AllocationTracker::total();
+        // Allocations of the steadiest repetition
+        if (timed && end.allocations - start.allocations < r.allocations) {
+            r.allocations = end.allocations - start.allocations;
+            r.allocatedBytes = end.bytes - start.bytes;
+            r.peakBytes = end.peak - start.live;
+            r.stageAllocations.clear();
+            const AllocationTracker::Stages after =
+                AllocationTracker::stages();
+            for (size_t i = 0; i < after.size(); ++i) {
+                const bool old = i < before.size();
+                const uint64_t n = after[i].second.allocations -
+                    (old ? before[i].second.allocations : 0);
+                const int64_t peak = after[i].second.peak -
+                    (old ? before[i].second.live : 0);
+                if (n > 0) {
+                    r.stageAllocations.push_back({after[i].first, n, peak});
+                }
+            }
+        }
+        if (c.teardown) c.teardown();
+        return time;
+    };
+    for (uint i = 0; i < options.warmup; ++i) once(false);
+    std::vector<double> times;
+    for (uint i = 0; i < options.repetitions; ++i) times.push_back(once(true));
+    std::sort(times.begin(), times.end());
+
+    r.name = name;
+    r.size = size;
+    r.items = items;
+    r.repetitions = times.size();
+    r.min = times.empty() ? 0 : times.front();
+    r.max = times.empty() ? 0 : times.back();
+    r.p10 = percentile(times, 10);
+    r.median = percentile(times, 50);
+    r.p90 = percentile(times, 90);
+    r.mean = times.empty() ? 0 :
+        std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+    done.push_back(r);
+
+    char line[192];
+    snprintf(line, sizeof(line), "%-28s %9zu %10zu %11.3f %11.3f %11.3f %12.4g",
+        name.c_str(), size, items, r.median, r.p10, r.p90, r.throughput());
+    std::cout << line;
+    if (AllocationTracker::enabled()) {
+        snprintf(line, sizeof(line), " %12.4g", r.allocationsPerItem());
+        std::cout << line;
+    }
+    std::cout << std::endl;
+}
+
+double Bench::percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    const double x = p / 100 * (sorted.size() - 1);
+    const size_t i = static_cast<size_t>(x);
+    if (i + 1 >= sorted.size()) return sorted.back();
+    return sorted[i] + (x - i) * (sorted[i+1] - sorted[i]);
+}
+
+
+void Bench::writeJSON(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) throw FileException();
+    out.precision(6);
+    out << "{\n  \"date\": " << quoted(timestamp()) << ",\n";
+    out << "  \"compiler\": " << quoted(__VERSION__) << ",\n";
+    out << "  \"threads\": " << omp_get_max_threads() << ",\n";
+    out << "  \"warmup\": " << options.warmup << ",\n";
+    out << "  \"repetitions\": " << options.repetitions << ",\n";
+    const bool allocations = AllocationTracker::enabled();
+    out << "  \"allocation_tracking\": " << (allocations ? "true" : "false") <<
+        ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < done.size(); ++i) {
+        const Result& r = done[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << quoted(r.name) <<
+            ", \"size\": " << r.size << ", \"items\": " << r.items <<
+            ", \"repetitions\": " << r.repetitions <<
+            ", \"min_ms\": " << r.min << ", \"p10_ms\": " << r.p10 <<
+            ", \"median_ms\": " << r.median << ", \"p90_ms\": " << r.p90 <<
+            ", \"max_ms\": " << r.max << ", \"mean_ms\": " << r.mean <<
+            ", \"items_per_s\": " << r.throughput();
+        if (allocations) {
+            out << ", \"allocations\": " << r.allocations <<
+                ", \"allocated_bytes\": " << r.allocatedBytes <<
+                ", \"peak_bytes\": " << r.peakBytes <<
+                ", \"allocations_per_item\": " << r.allocationsPerItem() <<
+                ", \"allocations_by_stage\": {";
+            for (size_t j = 0; j < r.stageAllocations.size(); ++j) {
+                const auto& s = r.stageAllocations[j];
+                out << (j ? ", " : "") <<
+                    quoted(s.name.empty() ? "untagged" : s.name) <<
+                    ": {\"allocations\": " << s.allocations <<
+                    ", \"peak_bytes\": " << s.peakBytes << "}";
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void Bench::writeCSV(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) throw FileException();
+    out.precision(6);
+    const bool allocations = AllocationTracker::enabled();
+    out << "name,size,items,repetitions,min_ms,p10_ms,median_ms,p90_ms,"
+        "max_ms,mean_ms,items_per_s";
+    if (allocations) {
+        out << ",allocations,allocated_bytes,peak_bytes,allocations_per_item";
+    }
+    out << '\n';
+    for (const Result& r : done) {
+        out << r.name << ',' << r.size << ',' << r.items << ',' <<
+            r.repetitions << ',' << r.min << ',' << r.p10 << ',' <<
+            r.median << ',' << r.p90 << ',' << r.max << ',' << r.mean <<
+            ',' << r.throughput();
+        if (allocations) {
+            out << ',' << r.allocations << ',' << r.allocatedBytes << ',' <<
+                r.peakBytes << ',' << r.allocationsPerItem();
+        }
+        out << '\n';
+    }
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// Micro benchmark harness. Every case is run a few times untimed to warm
+// up caches and lazily built data, then timed over a number of
+// repetitions; results give the median and percentiles of the wall time
+// of one repetition, and the throughput in items (vertices, samples,
+// evaluations...) per second at the median. In builds with
+// NICE_ALLOC_TRACK, results also count the heap allocations of the body,
+// in total and by stage, at its repetition with the fewest.
+class Bench {
+    public:
+        struct Options {
+            uint warmup = 1;
+            uint repetitions = 7;
+            std::string filter;     // only cases whose name contains it
+        };
+
+        // Setup and teardown run before and after each repetition,
+        // outside the timer; the body returns the number of items it
+        // processed
+        struct Case {
+            std::function<void()> setup;
+            std::function<size_t()> body;
+            std::function<void()> teardown;
+        };
+
+        struct StageAllocations {
+            std::string name;
+            uint64_t allocations;
+            int64_t peakBytes;      // highest growth of the stage's live bytes
+        };
+
+        struct Result {
+            std::string name;
+            size_t size;            // problem size, as given by the case
+            size_t items;           // items processed per repetition
+            uint repetitions;
+            double min, p10, median, p90, max, mean;    // ms
+            uint64_t allocations, allocatedBytes;
+            int64_t peakBytes;      // highest growth of live bytes
+            std::vector<StageAllocations> stageAllocations;
+            inline double throughput() const {
+                return median > 0 ? items / (median * 1e-3) : 0;
+            }
+            inline double allocationsPerItem() const {
+                return items > 0 ? double(allocations) / items : 0;
+            }
+        };
+
+        Bench(const Options& options) : options(options) {}
+
+        // Whether a case of that name passes the filter
+        bool selected(const std::string& name) const;
+        // Column names of the lines printed by run
+        void printHeader() const;
+        // Times the case and prints a line of results
+        void run(const std::string& name, size_t size, const Case& c);
+
+        const std::vector<Result>& results() const { return done; }
+        void writeJSON(const std::string& path) const;
+        void writeCSV(const std::string& path) const;
+
+        // Linearly interpolated percentile of sorted values
+        static double percentile(const std::vector<double>& sorted,
+            double p);
+
+        class FileException;
+
+    private:
+        const Options options;
+        std::vector<Result> done;
+};
+
+class Bench::FileException : public std::exception {
+    public: const char* what() { return "Could not write benchmark results"; }
+};
+
+#endif
\ No newline at end of file
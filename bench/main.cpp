@@ -0,0 +1,335 @@
+#include "Bench.hpp"
+#include "Sphere.hpp"
+#include "Torus.hpp"
+#include "Catenoid.hpp"
+#include "BezierPatch.hpp"
+#include "SinProductSF.hpp"
+#include "VectorField.hpp"
+#include "FieldBundle.hpp"
+#include <iostream>
+#include <cstdio>
+#include <unistd.h>
+
+// Benchmarks of the core kernels, at a few problem sizes each. Cases are
+// named kernel/variant, and --filter keeps those containing a string.
+
+namespace {
+    // Keeps results alive, so that the compiler cannot drop the work
+    volatile double sink;
+
+    // Exposes the normal computation, which meshes run when finalised
+    class NormalsTorus : public Torus {
+        public:
+            using Torus::Torus;
+            void normals() { computeNormals(); }
+    };
+
+    const double rOuter = 2, rInner = 1, radius = 1;
+
+    BezierPatch::ControlGrid* controlGrid() {
+        RandPoint::seed(1);
+        return new BezierPatch::ControlGrid(radius);
+    }
+
+    Mesh* torus(uint samples) {
+        Mesh* m = new Torus(samples, rOuter, rInner);
+        m->finalize(true);
+        return m;
+    }
+
+    // Regular and irregular constructors of every shape
+    void constructors(Bench& bench, bool quick) {
+        Mesh* m = nullptr;
+        auto drop = [&]() { delete m; m = nullptr; };
+        auto seed = []() { RandPoint::seed(1); };
+        const std::vector<uint> sizes = quick ?
+            std::vector<uint>{32, 128} : std::vector<uint>{32, 128, 512};
+        for (uint n : sizes) {
+            bench.run("construct/torus", n, {seed, [&]() {
+                m = new Torus(n, rOuter, rInner);
+                return m->vertNum();
+            }, drop});
+            bench.run("construct/catenoid", n, {seed, [&]() {
+                m = new Catenoid(n, rOuter, rInner);
+                return m->vertNum();
+            }, drop});
+            bench.run("construct/bezier", n, {seed, [&]() {
+                m = new BezierPatch(controlGrid(), n);
+                return m->vertNum();
+            }, drop});
+        }
+        for (uint n : quick ? std::vector<uint>{3, 5} :
+            std::vector<uint>{3, 5, 7}) {
+            bench.run("construct/sphere", n, {seed, [&]() {
+                m = new Sphere(n, radius);
+                return m->vertNum();
+            }, drop});
+        }
+        const std::vector<uint> irregular = quick ?
+            std::vector<uint>{1000} : std::vector<uint>{1000, 5000};
+        for (uint n : irregular) {
+            bench.run("construct/torus-irregular", n, {seed, [&]() {
+                m = new Torus(n, rOuter, rInner, 1.0);
+                return m->vertNum();
+            }, drop});
+            bench.run("construct/catenoid-irregular", n, {seed, [&]() {
+                m = new Catenoid(n, rOuter, rInner, 1.0);
+                return m->vertNum();
+            }, drop});
+            bench.run("construct/bezier-irregular", n, {seed, [&]() {
+                m = new BezierPatch(controlGrid(), n, 1.0);
+                return m->vertNum();
+            }, drop});
+            bench.run("construct/bezier-anisotropic", n, {seed, [&]() {
+                m = new BezierPatch(controlGrid(), n, 4.0);
+                return m->vertNum();
+            }, drop});
+        }
+    }
+
+    // Mesh processing: subdivision, normals, sampling of the surface
+    void processing(Bench& bench, bool quick) {
+        const std::vector<uint> sizes = quick ?
+            std::vector<uint>{128} : std::vector<uint>{128, 512};
+        for (uint n : sizes) {
+            Mesh* m = nullptr;
+            bench.run("refine/torus", n, {[&]() {
+                m = new Torus(n, rOuter, rInner);
+            }, [&]() {
+                m->refine();
+                return m->faceNum();
+            }, [&]() { delete m; }});
+
+            NormalsTorus nt(n, rOuter, rInner);
+            bench.run("normals/torus", n, {nullptr, [&]() {
+                nt.normals();
+                return nt.faceNum();
+            }, nullptr});
+
+            // The first draws build the sampler, during warmup
+            Mesh* t = torus(n);
+            const uint draws = 100000;
+            bench.run("randomPointUV/torus", n, {nullptr, [&]() {
+                double s = 0;
+                for (uint i = 0; i < draws; ++i) s += t->randomPointUV().x;
+                sink = s;
+                return draws;
+            }, nullptr});
+            for (uint samples : {10000, 100000}) {
+                bench.run("uniformSampling/torus-" +
+                    std::to_string(samples), n, {nullptr, [&]() {
+                    return t->uniformSampling(samples).size();
+                }, nullptr});
+            }
+            delete t;
+        }
+    }
+
+    // Differential quantities on a grid of the parametric square, and the
+    // field loops of a job
+    void differential(Bench& bench, bool quick) {
+        const uint grid = 300;
+        RandPoint::seed(1);
+        const std::vector<std::pair<std::string, Mesh*>> shapes = {
+            {"torus", new Torus(8, rOuter, rInner)},
+            {"catenoid", new Catenoid(8, rOuter, rInner)},
+            {"sphere", new Sphere(1, radius)},
+            {"bezier", new BezierPatch(controlGrid(), 8)}
+        };
+        for (const auto& s : shapes) {
+            const Mesh* m = s.second;
+            bench.run("diffEvaluate/" + s.first, grid * grid,
+                {nullptr, [&]() {
+                double sum = 0;
+                for (uint i = 0; i < grid; ++i) {
+                    for (uint j = 0; j < grid; ++j) {
+                        const DifferentialQuantities dq = m->diffEvaluate(
+                            (i + 0.5) / grid, (j + 0.5) / grid);
+                        sum += dq.meanCurvature();
+                    }
+                }
+                sink = sum;
+                return grid * grid;
+            }, nullptr});
+            delete m;
+        }
+
+        const std::vector<uint> sizes = quick ?
+            std::vector<uint>{128} : std::vector<uint>{128, 512};
+        for (uint n : sizes) {
+            Mesh* m = torus(n);
+            SinProductSF* signal = nullptr;
+            bench.run("fields/signal", n, {nullptr, [&]() {
+                signal = new SinProductSF(m, 2, 1);
+                return m->vertNum();
+            }, [&]() { delete signal; }});
+            signal = new SinProductSF(m, 2, 1);
+            // Laplacian, gradient and hessian of every vertex, as in a job
+            bench.run("fields/vertex", n, {nullptr, [&]() {
+                ScalarField laplacian(m);
+                VectorField gradient(m), hessian(m);
+                const uint vn = m->vertNum();
+                for (uint i = 0; i < vn; ++i) {
+                    const double u = m->cAttrib(i, Mesh::Attribute::U);
+                    const double v = m->cAttrib(i, Mesh::Attribute::V);
+                    const double f = signal->getValue(i, 0, 0);
+                    const double fu = signal->getValue(i, 1, 0);
+                    const double fv = signal->getValue(i, 0, 1);
+                    const double fuu = signal->getValue(i, 2, 0);
+                    const double fuv = signal->getValue(i, 1, 1);
+                    const double fvv = signal->getValue(i, 0, 2);
+                    laplacian.setValue(
+                        m->laplacian(u, v, f, fu, fv, fuu, fuv, fvv), i);
+                    gradient.setValue(m->gradient(u, v, f, fu, fv), i);
+                    hessian.setValue(
+                        m->hessian(u, v, f, fu, fv, fuu, fuv, fvv), i);
+                }
+                sink = laplacian.getValue(vn / 2);
+                return vn;
+            }, nullptr});
+            // Gradient at the centroid of every face
+            bench.run("fields/face", n, {nullptr, [&]() {
+                VectorField faceGradient(m, true);
+                const uint fn = m->faceNum();
+                for (uint i = 0; i < fn; ++i) {
+                    glm::dvec2 uv(0);
+                    for (uint k = 0; k < 3; ++k) {
+                        const uint vi = m->cFacei(i, k);
+                        uv += glm::dvec2(m->cAttrib(vi, Mesh::Attribute::U),
+                            m->cAttrib(vi, Mesh::Attribute::V));
+                    }
+                    uv /= glm::dvec1(3);
+                    double f, fu, fv, fuu, fuv, fvv;
+                    signal->evaluate(uv.x, uv.y, f, fu, fv, fuu, fuv, fvv);
+                    faceGradient.setValue(m->gradient(uv.x, uv.y, f, fu, fv),
+                        i);
+                }
+                sink = faceGradient.getValue(fn / 2).x;
+                return fn;
+            }, nullptr});
+            delete signal;
+            delete m;
+        }
+    }
+
+    // Reading and writing files in a scratch folder
+    void files(Bench& bench, bool quick, const std::string& dir) {
+        const std::string base = dir + "/nicebench" +
+            std::to_string(getpid());
+        const std::vector<uint> sizes = quick ?
+            std::vector<uint>{128} : std::vector<uint>{128, 512};
+        std::vector<std::string> written;
+        auto file = [&](const std::string& extension) {
+            written.push_back(base + extension);
+            return written.back();
+        };
+        for (uint n : sizes) {
+            Mesh* m = torus(n);
+            const uint vn = m->vertNum();
+            SinProductSF signal(m, 2, 1);
+            VectorField gradient(m);
+            for (uint i = 0; i < vn; ++i) {
+                gradient.setValue(glm::dvec3(signal.getValue(i, 1, 0),
+                    signal.getValue(i, 0, 1), 0), i);
+            }
+
+            const std::string obj = file(".obj");
+            bench.run("write/obj", n, {nullptr, [&]() {
+                m->writeOBJ(obj);
+                return vn;
+            }, nullptr});
+            const std::string ply = file(".ply");
+            bench.run("write/ply-ascii", n, {nullptr, [&]() {
+                m->writePLY(ply);
+                return vn;
+            }, nullptr});
+            bench.run("write/ply-binary", n, {nullptr, [&]() {
+                m->writePLY(ply, true);
+                return vn;
+            }, nullptr});
+            const std::string off = file(".off");
+            bench.run("write/off", n, {nullptr, [&]() {
+                m->writeOFF(off);
+                return vn;
+            }, nullptr});
+            const std::string txt = file(".txt");
+            bench.run("write/scalar", n, {nullptr, [&]() {
+                signal.write(txt);
+                return vn;
+            }, nullptr});
+            bench.run("write/vector", n, {nullptr, [&]() {
+                gradient.write(txt);
+                return vn;
+            }, nullptr});
+            for (bool binary : {false, true}) {
+                bench.run(binary ? "write/bundle-binary" :
+                    "write/bundle-ascii", n, {nullptr, [&]() {
+                    FieldBundle fb(m);
+                    fb.add("scalar", &signal);
+                    fb.add("gradient", &gradient);
+                    fb.write(ply, binary ? PlyWriter::BINARY :
+                        PlyWriter::ASCII);
+                    return vn;
+                }, nullptr});
+            }
+
+            m->writeOBJ(obj);
+            Mesh* r = nullptr;
+            bench.run("read/obj", n, {nullptr, [&]() {
+                r = new Mesh(false, false, false);
+                r->readOBJ(obj);
+                return r->vertNum();
+            }, [&]() { delete r; }});
+            delete m;
+        }
+        for (const std::string& path : written) std::remove(path.c_str());
+    }
+}
+
+
+int main(int argc, char **argv) {
+    Bench::Options options;
+    std::string json, csv, dir = "/tmp";
+    bool quick = false;
+    for (uint a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        const bool valued = (arg == "--filter" || arg == "--warmup" ||
+            arg == "--reps" || arg == "--json" || arg == "--csv" ||
+            arg == "--dir");
+        if (valued && a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        if (arg == "--filter") options.filter = argv[++a];
+        else if (arg == "--warmup") options.warmup = std::atoi(argv[++a]);
+        else if (arg == "--reps") options.repetitions = std::atoi(argv[++a]);
+        else if (arg == "--json") json = argv[++a];
+        else if (arg == "--csv") csv = argv[++a];
+        else if (arg == "--dir") dir = argv[++a];
+        else if (arg == "--quick") quick = true;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--filter text] " <<
+                "[--warmup n] [--reps n] [--json path] [--csv path] " <<
+                "[--dir scratch folder] [--quick]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.repetitions == 0) options.repetitions = 1;
+
+    Bench bench(options);
+    bench.printHeader();
+    constructors(bench, quick);
+    processing(bench, quick);
+    differential(bench, quick);
+    files(bench, quick, dir);
+
+    try {
+        if (!json.empty()) bench.writeJSON(json);
+        if (!csv.empty()) bench.writeCSV(csv);
+    }
+    catch (Bench::FileException e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
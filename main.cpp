@@ -6,8 +6,47 @@
 #include "Configuration.hpp"
 #include "VectorField.hpp"
 #include "SinProductSF.hpp"
+#include "FieldBundle.hpp"
+#include "AsyncWriter.hpp"
+#include "CompressedStream.hpp"
+#include "TriangulationCache.hpp"
+#include "JobScheduler.hpp"
+#include "Manifest.hpp"
+#include "Profiler.hpp"
+#include "ScalingStudy.hpp"
+#include <omp.h>
+#include <cctype>
+#include <cstdlib>
 
-void runConfig(char* pname, std::string fname, std::string cname, bool paral);
+// Settings shared by the meshes of a config, which are generated as
+// separate jobs
+struct ConfigRun {
+    ConfigRun(const JobSet& jobs) : jobs(jobs), spec(this->jobs.common()) {}
+    // Pending writes are completed first
+    ~ConfigRun() { delete writer; }
+
+    const JobSet jobs;
+    const JobSpec& spec;    // settings common to all jobs
+    uint seed;
+    uint repStringLen;      // digits of the mesh numbers
+    AsyncWriter *writer = nullptr;
+    size_t offset = 0;      // number of the first job among all configs
+    Manifest *manifest = nullptr;
+
+    // Name of the outputs of job k
+    std::string meshName(size_t k) const {
+        if (jobs.size() <= 1) return spec.name;
+        // Add leading 0s to the mesh number
+        std::string num = std::to_string(k);
+        while (num.length() < repStringLen) {
+            num = '0' + num;
+        }
+        return spec.name + num;
+    }
+};
+
+ConfigRun* setupConfig(const ConfigManager& cm, std::string cname);
+void runMesh(char* pname, ConfigRun* run, size_t k);
 
 
 int main(int argc, char **argv) {
@@ -15,383 +54,824 @@ int main(int argc, char **argv) {
     std::string filename = "./configuration.ini";
     std::vector<std::string> configs;
     bool firstarg = true;
-    bool parallel = false;
+    uint workers = 1;
+    const uint maxWorkers = 1024;
+    // OpenMP threads of a run, split between its workers and writer threads
+    uint threads = omp_get_max_threads();
+    // Jobs of this process: those in [first, last), then one in every
+    // shards of them
+    size_t first = 0, last = SIZE_MAX;
+    uint shard = 0, shards = 1;
+    std::string manifestPath, mergePath, tracePath;
+    // Scaling study: sizes and thread counts of its runs
+    std::string scalingPath;
+    std::vector<uint> scalingSizes, scalingThreads;
     // Parse arguments
     for (uint a = 1; a < argc; ++a) {
-        if (argv[a][0] == '-') {
-            switch (argv[a][1]) {
-                case 'p':
-                    parallel = true;
-                default:
-                    continue;
+        const std::string arg = argv[a];
+        if (arg[0] != '-') {
+            if (firstarg) { filename = arg; firstarg = false; }
+            else configs.push_back(arg);
+            continue;
+        }
+        // Options with a separate value
+        const bool valued = (arg == "--shard" || arg == "--range" ||
+            arg == "--manifest" || arg == "--merge" || arg == "--trace" ||
+            arg == "--scaling" || arg == "--sizes" || arg == "--threads");
+        if (valued && a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        if (arg == "--shard") {
+            if (sscanf(argv[++a], "%u/%u", &shard, &shards) != 2 ||
+                shards == 0 || shard >= shards) {
+                std::cerr << "Invalid shard " << argv[a] <<
+                    " (expected i/N with 0 <= i < N)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--range") {
+            unsigned long long f, l;
+            if (sscanf(argv[++a], "%llu:%llu", &f, &l) != 2 || f > l) {
+                std::cerr << "Invalid range " << argv[a] <<
+                    " (expected a:b with a <= b)" << std::endl;
+                return 1;
             }
+            first = f;
+            last = l;
         }
-        else {
-            if (firstarg) { filename = argv[a]; firstarg = false; }
-            else configs.push_back(argv[a]);
+        else if (arg == "--manifest") manifestPath = argv[++a];
+        else if (arg == "--merge") mergePath = argv[++a];
+        else if (arg == "--trace") tracePath = argv[++a];
+        else if (arg == "--scaling") scalingPath = argv[++a];
+        else if (arg == "--sizes" || arg == "--threads") {
+            std::vector<uint>& list = (arg == "--sizes") ?
+                scalingSizes : scalingThreads;
+            list = ScalingStudy::parseList(argv[++a]);
+            if (list.empty()) {
+                std::cerr << "Invalid list " << argv[a] << " for " << arg <<
+                    " (expected positive integers, e.g. 1,2,4)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "-p") workers = omp_get_max_threads();
+        else if (arg.compare(0, 2, "-j") == 0) {
+            if (arg.size() == 2 && a + 1 >= argc) {
+                std::cerr << "Missing value for -j" << std::endl;
+                return 1;
+            }
+            const std::string value = (arg.size() > 2) ? arg.substr(2) :
+                argv[++a];
+            char* end;
+            const unsigned long n = strtoul(value.c_str(), &end, 10);
+            if (value.empty() || !isdigit(static_cast<unsigned char>(value[0]))
+                || *end != '\0' || n == 0 || n > maxWorkers) {
+                std::cerr << "Invalid number of workers " << value <<
+                    " (expected 1 to " << maxWorkers << ")" << std::endl;
+                return 1;
+            }
+            workers = n;
         }
     }
 
-    if (configs.size() == 0) {
-        // If no configs are specified, run them all
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            std::cerr << "Please check your configuration file (" <<
-                filename << std::endl;
-            return 1;
-        }
-        while (!file.eof()) {
-            std::string line;
-            file >> line;
-            if (line.front() == '[' && line.back() == ']') {
-                configs.push_back(line.substr(1, line.length()-2));
+    // Merge the manifests given as arguments
+    if (!mergePath.empty()) {
+        std::vector<std::string> inputs;
+        if (!firstarg) inputs.push_back(filename);
+        inputs.insert(inputs.end(), configs.begin(), configs.end());
+        try {
+            const std::vector<size_t> missing =
+                Manifest::merge(inputs, mergePath);
+            if (!missing.empty()) {
+                std::cerr << missing.size() << " jobs missing, first " <<
+                    missing.front() << std::endl;
+                return 1;
             }
         }
-        file.close();
+        catch (Manifest::FileException e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Scaling studies time whole configurations, each point in its own
+    // process
+    if (!scalingPath.empty() && (shards > 1 || first > 0 ||
+        last < SIZE_MAX || !tracePath.empty())) {
+        std::cerr << "Scaling studies cannot be combined with --shard, " <<
+            "--range or --trace" << std::endl;
+        return 1;
+    }
+
+    ConfigManager cm(filename);
+    if (!cm) {
+        for (const std::string& e : cm.errors()) std::cerr << e << std::endl;
+        std::cerr << "Please check your configuration file (" <<
+            filename << ")" << std::endl;
+        return 1;
     }
+    // If no configs are specified, run them all
+    if (configs.size() == 0) configs = cm.sections();
 
     std::cout << "Running configuration(s): ";
     for (std::string c : configs) std::cout << c << " ";
     std::cout << std::endl;
 
-    const uint confCount = std::max(1, argc - 2);
-    
-    if (parallel) {
-        #pragma omp parallel for
-        for (std::string config : configs) {
-            runConfig(argv[0], filename, config, true);
-        }
+    if (!tracePath.empty()) {
+#ifdef NICE_PROFILE
+        Profiler::trace(tracePath);
+#else
+        std::cerr << "Tracing needs a build with profiling (make PROFILE=1)" <<
+            std::endl;
+#endif
     }
-    else {
+
+    // Runs the jobs of the configs, or the part of them selected for this
+    // process
+    auto execute = [&](const std::vector<std::string>& configs,
+        std::string manifestPath) {
+        // Processes running parts of the same jobs record them in manifests
+        const bool partial = (shards > 1 || first > 0 || last < SIZE_MAX);
+        if (partial && manifestPath.empty()) {
+            manifestPath = "manifest";
+            if (first > 0 || last < SIZE_MAX) {
+                manifestPath += "-" + std::to_string(first) + "-" +
+                    (last < SIZE_MAX ? std::to_string(last) : "end");
+            }
+            if (shards > 1) {
+                manifestPath += "-" + std::to_string(shard) + "of" +
+                    std::to_string(shards);
+            }
+            manifestPath += ".txt";
+        }
+
+        // Every mesh of every config is a job, set up only when it is run.
+        // Jobs are numbered across configs, and a process running a part of
+        // them takes, among those in its range, one in every shards of them, so
+        // that shards get a similar mix of configs. Meshes shown in the viewer
+        // are generated on this thread, which owns the window.
+        JobScheduler scheduler(workers);
+        std::vector<ConfigRun*> runs;
+        std::vector<size_t> offsets;    // of the jobs of each run
+        size_t total = 0;
         for (std::string config : configs) {
-            runConfig(argv[0], filename, config, false);
+            ConfigRun *run = setupConfig(cm, config);
+            if (!run) continue;
+            if (partial && !run->spec.fixedSeed) {
+                // Each process would draw its own seed from the clock
+                std::cerr << "Sharded runs need a seed (conf:" << config << ')' <<
+                    std::endl;
+                delete run;
+                continue;
+            }
+            // Triangulations are shared by meshes with the same points, in
+            // a single memory cache
+            if (!runs.empty() && run->spec.triangulationCacheMemory !=
+                runs.front()->spec.triangulationCacheMemory) {
+                std::cerr << "triangulationCacheMemory must be the same for "
+                    "all configurations run together (conf:" << config <<
+                    ')' << std::endl;
+                delete run;
+                continue;
+            }
+            runs.push_back(run);
+            offsets.push_back(total);
+            total += run->jobs.size();
+        }
+        // The manifest is a journal of the jobs done, which lets a run resume
+        // where a previous one stopped
+        Manifest manifest(filename, total, "range " + std::to_string(first) +
+            ":" + (last < SIZE_MAX ? std::to_string(last) : "end") +
+            ", shard " + std::to_string(shard) + "/" + std::to_string(shards));
+        if (!manifestPath.empty()) {
+            try {
+                manifest.open(manifestPath);
+            }
+            catch (Manifest::FileException e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        std::vector<ConfigRun*> active;     // with jobs in this process
+        for (uint r = 0; r < runs.size(); ++r) {
+            ConfigRun *run = runs[r];
+            const size_t offset = offsets[r];
+            run->offset = offset;
+            if (!manifestPath.empty()) run->manifest = &manifest;
+            // First job of the config in this process, then every shards-th
+            const size_t from = std::max(first, offset);
+            const size_t to = std::min(last, offset + run->jobs.size());
+            if (from >= to) continue;
+            const size_t start = from + (shard + shards -
+                (from - first) % shards) % shards;
+            if (start >= to) continue;
+            const size_t count = (to - start + shards - 1) / shards;
+            const bool interactive = (run->spec.interactive && !run->spec.stream);
+            scheduler.add(count, [=](size_t j) {
+                runMesh(argv[0], run, start + j * shards - offset);
+            }, interactive);
+            active.push_back(run);
+        }
+        if (!runs.empty()) {
+            TriangulationCache::configure(
+                runs.front()->spec.triangulationCacheMemory);
+        }
+        // Writes overlap with the generation of the next meshes. Writer
+        // threads and workers split the OpenMP threads, one share each, so
+        // that parallel writes do not oversubscribe the cores either
+        uint writers = 0;
+        for (ConfigRun *run : active) writers += run->spec.writerThreads;
+        const uint share = std::max(1u,
+            threads / (scheduler.workerCount() + writers));
+        for (ConfigRun *run : active) {
+            run->writer = new AsyncWriter(run->spec.writerThreads,
+                run->spec.writerMemory, share);
+        }
+        omp_set_num_threads(std::max(scheduler.workerCount(),
+            threads - std::min(threads, writers * share)));
+        scheduler.run();
+        for (ConfigRun *run : runs) delete run;
+        omp_set_num_threads(threads);
+        Profiler::finish();
+
+        if (!manifestPath.empty()) {
+            try {
+                manifest.close();
+            }
+            catch (Manifest::FileException e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    };
+
+    // Each size and thread count of a scaling study is a separate run
+    if (!scalingPath.empty()) {
+        ScalingStudy study(scalingSizes, scalingThreads);
+        study.run(cm, configs, [&](const ScalingStudy::Point& p) {
+            // Workers and writers are threads too, so they are limited by
+            // the point
+            workers = std::min(workers, p.threads);
+            threads = p.threads;
+            return execute({p.config}, p.manifest);
+        });
+        try {
+            study.write(scalingPath);
         }
+        catch (ScalingStudy::FileException e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
     }
-    
-    return 0;
+    return execute(configs, manifestPath);
 }
 
 
-void runConfig(char* pname, std::string fname, std::string cname,
-    bool parallel) {
-    ConfigManager cm(fname, cname);
-    if (!cm) {
-        std::cerr << "Please check your configuration file (" <<
-            fname << ") for config " << cname << std::endl;
+ConfigRun* setupConfig(const ConfigManager& cm, std::string cname) {
+    ConfigRun *run;
+    try {
+        run = new ConfigRun(cm.jobs(cname));
+    }
+    catch (ConfigManager::InvalidValueException e) {
+        std::cerr << e.what() << " (conf:" << cname << ')' << std::endl;
+        return nullptr;
+    }
+    const JobSpec& spec = run->spec;
+
+    // Seed, which is shared by all meshes of the config
+    run->seed = spec.fixedSeed ? spec.seed : time(0);
+
+    // determines the number of leading zeroes used in mesh names
+    run->repStringLen =
+        std::to_string(std::max<size_t>(1, run->jobs.size())-1).length();
+
+    // Streaming skips the mesh, so mesh processing and fields are unavailable
+    if (spec.stream && (spec.centered || spec.noise > 0 || spec.scalarField)) {
+        std::cerr << "Processing and fields are ignored when streaming (" <<
+            spec.section << ")" << std::endl;
+    }
+
+    return run;
+}
+
+
+void runMesh(char* pname, ConfigRun* run, size_t k) {
+    const std::string& cname = run->spec.section;
+    AsyncWriter& writer = *run->writer;
+    const std::string name = run->meshName(k);
+
+    // Each mesh draws from its own streams, keyed by config and index
+    RandPoint::seed(run->seed);
+    RandPoint::job(RandPoint::hash(cname), k);
+
+    // Entry of the job in the manifest, recorded once its outputs are
+    // written. Jobs recorded by a previous run with the same parameters
+    // and intact outputs are skipped.
+    Manifest *manifest = run->manifest;
+    Manifest::Entry entry;
+    std::vector<std::string> files;     // written so far
+    if (manifest) {
+        entry = {run->offset + k, cname, k, run->seed, name, false,
+            run->jobs.hash(k, RandPoint::jobKey()), {}};
+        if (manifest->reuse(entry)) return;
+    }
+    // Checksums of the files, into the entry
+    auto record = [manifest](Manifest::Entry entry, bool ok,
+        const std::vector<std::string>& files) {
+        if (!manifest) return;
+        PROFILE_SCOPE("checksum");
+        for (const std::string& path : files) {
+            uint64_t sum;
+            ok = Manifest::checksum(path, sum) && ok;
+            entry.files.push_back({path, sum});
+        }
+        entry.ok = ok;
+        manifest->add(entry);
+    };
+
+    // Parameters of this job, which are the common ones unless some vary
+    JobSpec varied;
+    try {
+        if (run->jobs.varies()) varied = run->jobs.job(k, RandPoint::jobKey());
+    }
+    catch (ConfigManager::InvalidValueException e) {
+        std::cerr << e.what() << " (conf:" << cname << ", job " << k << ')' <<
+            std::endl;
+        record(entry, false, files);
         return;
     }
+    const JobSpec& spec = run->jobs.varies() ? varied : run->spec;
+    const std::string& zext = spec.zext;
+    const bool stream = spec.stream;
+    SurfaceSampling::Options sampling = spec.sampling;
 
-    // Apply configuration
+    // Timings of the stages of the job (with NICE_PROFILE), completed by
+    // the thread that writes its outputs
+    Profiler::Job *profile = new Profiler::Job(cname, k, name);
+    const std::string profilePath = spec.outFolder + name + ".profile.json";
+    Profiler::Attach attach(profile);
 
-    // Seed
-    if (cm["seed"] != "") RandPoint::seed(std::stoi(cm["seed"]));
-    else RandPoint::seed();
+    // Files written outside of the output stage, whose errors fail the job
+    bool written = true;
 
-    const uint repeat = std::stoi(cm["repeat"]);
-    // determines the number of leading zeroes used in mesh names
-    const uint repStringLen = std::to_string(repeat-1).length();
-    for (uint i = 0; i < repeat; ++i) {
-        // Mesh
-        Mesh *mesh = nullptr;
-        BezierPatch::ControlGrid *cg = nullptr;
-        PlaneSampling *smp = nullptr;
-        bool errStop = false;
+    // Record of the parameters that vary between jobs
+    if (run->jobs.varies()) {
+        const std::string path =
+            spec.outFolder + name + ".params" + zext;
+        OutFile file(path);
+        if (file.is_open()) {
+            file << "; " << cname << " job " << k << ", seed " << run->seed <<
+                '\n' << run->jobs.record(k, RandPoint::jobKey());
+            file.close();
+            files.push_back(path);
+        }
+        if (!file) {
+            std::cerr << "Cannot write " << path << std::endl;
+            written = false;
+        }
+    }
+
+    // Streaming output of regular grids, which are never held in memory
+    if (stream) {
+        bool ok = true;
+        const std::string path = spec.outFolder + name + ".ply" + zext;
+        const bool quad = spec.quad;
         try {
-            if (cm["inputPlane"] != "")
-                smp = new PlaneSampling(cm["inputPlane"]);
-
-            if (cm["shape"] == "torus") {
-                // Given plane sampling
-                if (smp) {
-                    mesh = new Torus(
-                        *smp,
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"])
-                    );
-                }
-                // Given mesh
-                else if (cm["inputShape"] != "") {
-                    mesh = new Torus(
-                        cm["inputShape"],
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"])
-                    );
-                }
-                // Regular sampling
-                else if (cm["anisotropy"] == "") {
-                    mesh = new Torus(
-                        std::stoi(cm["samples"]),
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"]),
-                        cm["elementType"] == "quad"
-                    );
-                }
-                // Irregular sampling
-                else {
-                    mesh = new Torus(
-                        std::stoi(cm["samples"]),
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"]),
-                        std::stod(cm["anisotropy"])
-                    );
-                }
+            PROFILE_SCOPE("stream");
+            if (!spec.inputPlane.empty() || !spec.inputShape.empty() ||
+                spec.irregular) {
+                std::cerr << "Only regular sampling can be streamed (" <<
+                    cname << ")" << std::endl;
+                ok = false;
             }
-            else if (cm["shape"] == "catenoid") {
-                // Given plane sampling
-                if (smp) {
-                    mesh = new Catenoid(
-                        *smp,
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"])
-                    );
-                }
-                // Given mesh
-                else if (cm["inputShape"] != "") {
-                    mesh = new Catenoid(
-                        cm["inputShape"],
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"])
-                    );
-                }
-                // Regular sampling
-                else if (cm["anisotropy"] == "") {
-                    mesh = new Catenoid(
-                        std::stoi(cm["samples"]),
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"]),
-                        cm["elementType"] == "quad"
-                    );
-                }
-                // Irregular sampling
-                else {
-                    mesh = new Catenoid(
-                        std::stoi(cm["samples"]),
-                        std::stod(cm["outerRadius"]),
-                        std::stod(cm["innerRadius"]),
-                        std::stod(cm["anisotropy"])
-                    );
-                }
+            else if (spec.shape == JobSpec::TORUS) {
+                Torus::stream(path, name,
+                    spec.samples,
+                    spec.outerRadius,
+                    spec.innerRadius,
+                    quad
+                );
             }
-            else if (cm["shape"] == "sphere") {
-                // Given mesh
-                if (cm["inputShape"] != "") {
-                    mesh = new Sphere(
-                        cm["inputShape"],
-                        std::stod(cm["radius"])
-                    );
-                }
-                // Regular sampling
-                else if (cm["anisotropy"] == "") {
-                    mesh = new Sphere(
-                        std::stoi(cm["subdivision"]),
-                        std::stod(cm["radius"])
-                    );
-                }
+            else if (spec.shape == JobSpec::CATENOID) {
+                Catenoid::stream(path, name,
+                    spec.samples,
+                    spec.outerRadius,
+                    spec.innerRadius,
+                    quad
+                );
             }
-            else if (cm["shape"] == "bezier") {
-                cg = new BezierPatch::ControlGrid(
-                    std::stod(cm["radius"]),
-                    std::stod(cm["borderVariance"]),
-                    std::stod(cm["innerVariance"])
+            else if (spec.shape == JobSpec::BEZIER) {
+                BezierPatch::ControlGrid cg(
+                    spec.radius,
+                    spec.borderVariance,
+                    spec.innerVariance
                 );
-
-                // Given plane sampling
-                if (smp) {
-                    mesh = new BezierPatch(cg, *smp);
-                }
-                // Regular sampling
-                else if (cm["anisotropy"] == "") {
-                    mesh = new BezierPatch(cg,
-                        std::stoi(cm["samples"]));
-                }
-                // Irregular sampling
-                else {
-                    mesh = new BezierPatch(cg, 
-                        std::stoi(cm["samples"]), std::stod(cm["anisotropy"]));
-                }
+                BezierPatch::stream(path, name, &cg,
+                    spec.samples);
             }
             else {
-                std::cerr << "Invalid shape (" <<
-                    fname << ")" << std::endl;
-                errStop = true;
+                std::cerr << "Streaming is not available for spheres (" <<
+                    cname << ")" << std::endl;
+                ok = false;
             }
         }
         catch (Mesh::FileOpenException e) {
-            std::cerr << e.what() << " (conf:" << cname << ')' << std::endl;
-            errStop = true;
+            std::cerr << e.what() << " (conf:" << cname << ')' <<
+                std::endl;
+            ok = false;
         }
-        delete smp;
-        if (errStop) {
-            delete mesh;
-            continue;
+        catch (Mesh::FileWriteException e) {
+            std::cerr << e.what() << " (conf:" << cname << ')' <<
+                std::endl;
+            ok = false;
         }
-        
-        
-        // Name
-        if (cm["name"] != "") {
-            std::string num;
-            if (repeat > 1) {
-                // Add leading 0s to the mesh number
-                num = std::to_string(i);
-                while (num.length() < repStringLen) {
-                    num = '0' + num;
-                }
+        files.push_back(path);
+        record(entry, ok && written, files);
+        profile->write(profilePath);
+        delete profile;
+        return;
+    }
+
+    // Mesh
+    Mesh *mesh = nullptr;
+    BezierPatch::ControlGrid *cg = nullptr;
+    PlaneSampling *smp = nullptr;
+    bool errStop = false;
+    sampling.planePath = spec.savePlane ?
+        spec.outFolder + name + "Plane.off" + zext : "";
+    sampling.cacheFolder = spec.triangulationCache;
+    try {
+        PROFILE_SCOPE("construct");
+        if (!spec.inputPlane.empty()) {
+            smp = new PlaneSampling(spec.inputPlane);
+            if (!sampling.planePath.empty())
+                smp->print(sampling.planePath);
+        }
+
+        if (spec.shape == JobSpec::TORUS) {
+            // Given plane sampling
+            if (smp) {
+                mesh = new Torus(
+                    *smp,
+                    spec.outerRadius,
+                    spec.innerRadius
+                );
             }
-            else num = "";
-            mesh->name = cm["name"] + num;
-        }
-
-        // Write cg
-        if (cm["exportControlGrid"] == "separate" && cg) {
-            std::string basename = cm["outFolder"] + mesh->name;
-            cg->writeCoordinate(basename + "x.txt", 0);
-            cg->writeCoordinate(basename + "y.txt", 1);
-            cg->writeCoordinate(basename + "z.txt", 2);
-        }
-
-
-        // Processing
-        if (cm["centered"] == "true") {
-            mesh->makeCentered();
-        }
-        if (std::stod(cm["noise"]) > 0) {
-            const auto t = cm["noiseType"];
-            const auto ael = mesh->getAverageEdgeLength();
-            bool nrm, tan;
-            nrm = (t == "3d" || t == "normal");
-            tan = (t == "3d" || t == "tangential");
-            const double variance = sqrt(ael * std::stod(cm["noise"]));
-            mesh->gaussNoise(variance, nrm, tan);
-        }
-        
-        // Mode
-        if (cm["interactive"] == "true" && !parallel) {
-            Trackball trb;
-            Browser::init(pname, &trb);
-            mesh->finalize();
-            Browser::setMesh(mesh);
-            Browser::setOutPath(cm["outFolder"]);
-            Browser::launch();
-        }
-        else {  // save file
-            mesh->finalize(true);
-            if (cm["interactive"] == "true") {
-                std::cerr << "Cannot run interactively in parallel (" <<
-                    cname << ")" << std::endl;
+            // Given mesh
+            else if (!spec.inputShape.empty()) {
+                mesh = new Torus(
+                    spec.inputShape,
+                    spec.outerRadius,
+                    spec.innerRadius
+                );
+            }
+            // Regular sampling
+            else if (!spec.irregular) {
+                mesh = new Torus(
+                    spec.samples,
+                    spec.outerRadius,
+                    spec.innerRadius,
+                    spec.quad
+                );
+            }
+            // Irregular sampling
+            else {
+                mesh = new Torus(
+                    spec.samples,
+                    spec.outerRadius,
+                    spec.innerRadius,
+                    spec.anisotropy,
+                    sampling
+                );
+            }
+        }
+        else if (spec.shape == JobSpec::CATENOID) {
+            // Given plane sampling
+            if (smp) {
+                mesh = new Catenoid(
+                    *smp,
+                    spec.outerRadius,
+                    spec.innerRadius
+                );
+            }
+            // Given mesh
+            else if (!spec.inputShape.empty()) {
+                mesh = new Catenoid(
+                    spec.inputShape,
+                    spec.outerRadius,
+                    spec.innerRadius
+                );
+            }
+            // Regular sampling
+            else if (!spec.irregular) {
+                mesh = new Catenoid(
+                    spec.samples,
+                    spec.outerRadius,
+                    spec.innerRadius,
+                    spec.quad
+                );
+            }
+            // Irregular sampling
+            else {
+                mesh = new Catenoid(
+                    spec.samples,
+                    spec.outerRadius,
+                    spec.innerRadius,
+                    spec.anisotropy,
+                    sampling
+                );
+            }
+        }
+        else if (spec.shape == JobSpec::SPHERE) {
+            // Given mesh
+            if (!spec.inputShape.empty()) {
+                mesh = new Sphere(
+                    spec.inputShape,
+                    spec.radius
+                );
+            }
+            // Regular sampling
+            else if (!spec.irregular) {
+                mesh = new Sphere(
+                    spec.subdivision,
+                    spec.radius
+                );
+            }
+        }
+        else if (spec.shape == JobSpec::BEZIER) {
+            cg = new BezierPatch::ControlGrid(
+                spec.radius,
+                spec.borderVariance,
+                spec.innerVariance
+            );
+
+            // Given plane sampling
+            if (smp) {
+                mesh = new BezierPatch(cg, *smp);
+            }
+            // Regular sampling
+            else if (!spec.irregular) {
+                mesh = new BezierPatch(cg,
+                    spec.samples);
+            }
+            // Irregular sampling
+            else {
+                mesh = new BezierPatch(cg, 
+                    spec.samples, spec.anisotropy,
+                    sampling);
+            }
+        }
+    }
+    catch (Mesh::FileOpenException e) {
+        std::cerr << e.what() << " (conf:" << cname << ')' << std::endl;
+        errStop = true;
+    }
+    catch (Mesh::FileWriteException e) {
+        std::cerr << e.what() << " (conf:" << cname << ')' << std::endl;
+        errStop = true;
+    }
+    delete smp;
+    if (errStop) {
+        delete mesh;
+        record(entry, false, files);
+        profile->write(profilePath);
+        delete profile;
+        return;
+    }
+    // Triangulated parameter plane, when one was read or sampled
+    if (!sampling.planePath.empty() && (!spec.inputPlane.empty() ||
+        (spec.irregular && spec.inputShape.empty()))) {
+        files.push_back(sampling.planePath);
+    }
+    
+    
+    // Name
+    if (!spec.name.empty()) mesh->name = name;
+
+    // Write cg
+    if (spec.separateControlGrid && cg) {
+        std::string basename = spec.outFolder + mesh->name;
+        try {
+            for (uint c = 0; c < 3; ++c) {
+                files.push_back(basename + "xyz"[c] + ".txt" + zext);
+                cg->writeCoordinate(files.back(), c);
             }
         }
-        std::string fname = cm["outFolder"] + mesh->name + ".";
-        if (cm["saveOBJ"] == "true") mesh->writeOBJ(fname + "obj");
-        if (cm["savePLY"] == "true") mesh->writePLY(fname + "ply");
-        if (cm["saveOFF"] == "true") mesh->writeOFF(fname + "off");
-
-        // Scalar field
-        if (cm["scalarField"] == "true") {
-            const double freq = std::stof(cm["scalarFrequency"]);
-            const double ampl = std::stof(cm["scalarAmplitude"]);
-            SinProductSF signal(mesh, freq, ampl, (cm["shape"] == "sphere"));
-
-            // Write
-            const bool head = (cm["scalarHeader"] == "true");
-            signal.write(cm["outFolder"] + mesh->name + "Scalar.txt", head);
-
-            // Compute differential quantities
-            const bool lap = cm["scalarLaplacian"] == "true";
-            const bool gra = cm["scalarGradient"] == "true";
-            const bool hes = cm["scalarHessian"] == "true";
-            const bool euv = cm["exportUV"] == "true";
-            if (lap || gra || hes || euv) {
-                ScalarField *laplacian = nullptr;
-                VectorField *gradient = nullptr, *hessian = nullptr,
-                    *uvfield = nullptr;
-
-                // Create
-                if (lap) laplacian = new ScalarField(mesh);
-                if (gra) gradient = new VectorField(mesh);
-                if (hes) hessian = new VectorField(mesh);
-                if (euv) uvfield = new VectorField(mesh);
+        catch (Mesh::FileOpenException e) {
+            std::cerr << e.what() << " (conf:" << cname << ')' << std::endl;
+            written = false;
+        }
+        catch (Mesh::FileWriteException e) {
+            std::cerr << e.what() << " (conf:" << cname << ')' << std::endl;
+            written = false;
+        }
+    }
+
+
+    // Processing
+    if (spec.centered) {
+        mesh->makeCentered();
+    }
+    if (spec.noise > 0) {
+        const auto ael = mesh->getAverageEdgeLength();
+        const double variance = sqrt(ael * spec.noise);
+        mesh->gaussNoise(variance, spec.normalNoise, spec.tangentialNoise);
+    }
+    
+    // Mode (interactive meshes are run on the main thread)
+    if (spec.interactive) {
+        Trackball trb;
+        Browser::init(pname, &trb);
+        mesh->finalize();
+        Browser::setMesh(mesh);
+        Browser::setOutPath(spec.outFolder);
+        Browser::launch();
+    }
+    else {  // save file
+        mesh->finalize(true);
+    }
+    const bool bundle = spec.saveBundle;
+
+    // Scalar field
+    SinProductSF *signal = nullptr;
+    ScalarField *laplacian = nullptr;
+    VectorField *gradient = nullptr, *hessian = nullptr,
+        *uvfield = nullptr, *faceGradient = nullptr;
+    if (spec.scalarField) {
+        PROFILE_SCOPE("fields");
+        const double freq = spec.scalarFrequency;
+        const double ampl = spec.scalarAmplitude;
+        signal = new SinProductSF(mesh, freq, ampl,
+            (spec.shape == JobSpec::SPHERE));
+
+        // Compute differential quantities
+        const bool lap = spec.scalarLaplacian;
+        const bool gra = spec.scalarGradient;
+        const bool hes = spec.scalarHessian;
+        const bool euv = spec.exportUV && !bundle;
+        if (lap || gra || hes || euv) {
+            // Create
+            if (lap) laplacian = new ScalarField(mesh);
+            if (gra) gradient = new VectorField(mesh);
+            if (hes) hessian = new VectorField(mesh);
+            if (euv) uvfield = new VectorField(mesh);
+            
+            // Compute
+            const uint vn = mesh->vertNum();
+            for(uint i = 0; i < vn; ++i) {
+                const double u = mesh->cAttrib(i, Mesh::Attribute::U);
+                const double v = mesh->cAttrib(i, Mesh::Attribute::V);
+                const double f = signal->getValue(i, 0, 0);
+                const double fu = signal->getValue(i, 1, 0);
+                const double fv = signal->getValue(i, 0, 1);
+                const double fuu = signal->getValue(i, 2, 0);
+                const double fuv = signal->getValue(i, 1, 1);
+                const double fvv = signal->getValue(i, 0, 2);
                 
-                // Compute
-                const uint vn = mesh->vertNum();
-                for(uint i = 0; i < vn; ++i) {
-                    const double u = mesh->cAttrib(i, Mesh::Attribute::U);
-                    const double v = mesh->cAttrib(i, Mesh::Attribute::V);
-                    const double f = signal.getValue(i, 0, 0);
-                    const double fu = signal.getValue(i, 1, 0);
-                    const double fv = signal.getValue(i, 0, 1);
-                    const double fuu = signal.getValue(i, 2, 0);
-                    const double fuv = signal.getValue(i, 1, 1);
-                    const double fvv = signal.getValue(i, 0, 2);
-                    
-                    
-                    if (lap) laplacian->setValue(
-                        mesh->laplacian(u, v, f, fu, fv, fuu, fuv, fvv), i);
-                    if (gra) gradient->setValue(
-                        mesh->gradient(u, v, f, fu, fv), i);
-                    if (hes) hessian->setValue(
-                        mesh->hessian(u, v, f, fu, fv, fuu, fuv, fvv), i);
-                    if (euv) uvfield->setValue(glm::dvec3(u,v,0), i);
-                }
+                
+                if (lap) laplacian->setValue(
+                    mesh->laplacian(u, v, f, fu, fv, fuu, fuv, fvv), i);
+                if (gra) gradient->setValue(
+                    mesh->gradient(u, v, f, fu, fv), i);
+                if (hes) hessian->setValue(
+                    mesh->hessian(u, v, f, fu, fv, fuu, fuv, fvv), i);
+                if (euv) uvfield->setValue(glm::dvec3(u,v,0), i);
+            }
+        }
 
-                // Write and destroy
-                if (lap) {
-                    laplacian->write(
-                        cm["outFolder"] + mesh->name + "Laplacian.txt",
-                        head
+        // Face diff. quantities
+        if (spec.scalarFaceGradient) {
+            const uint fn = mesh->faceNum();
+            faceGradient = new VectorField(mesh, true);
+            for (uint i = 0; i < fn; ++i) {
+                uint f[3] = {
+                    mesh->cFacei(i, 0),
+                    mesh->cFacei(i, 1),
+                    mesh->cFacei(i, 2)
+                };
+                glm::dvec2 centroidUV(0);
+                for (uint ti = 0; ti < 3; ++ti) {
+                    const glm::dvec2 uv(
+                        mesh->cAttrib(f[ti], Mesh::Attribute::U),
+                        mesh->cAttrib(f[ti], Mesh::Attribute::V)
                     );
-                    delete laplacian;
+                    centroidUV += uv;
                 }
-                if (gra) {
-                    gradient->write(
-                        cm["outFolder"] + mesh->name + "Gradient.txt",
-                        head
-                    );
-                    delete gradient;
+                centroidUV /= glm::dvec1(3);
+                double ff, ffu, ffv, ffuu, ffuv, ffvv;
+		            signal->evaluate(centroidUV.x, centroidUV.y,
+                    ff, ffu, ffv, ffuu, ffuv, ffvv);
+                faceGradient->setValue(
+                    mesh->gradient(centroidUV.x, centroidUV.y,
+                        ff, ffu, ffv), i);
+            }
+        }
+    }
+
+    // Output stage, which takes ownership of the mesh and its fields
+    const std::string base = spec.outFolder + mesh->name;
+    const bool head = spec.scalarHeader;
+    const bool obj = spec.saveOBJ;
+    const bool ply = spec.savePLY;
+    const bool off = spec.saveOFF;
+    const PlyWriter::Format bundleFormat = spec.bundleFormat;
+    auto output = [=]() mutable {
+        Profiler::Attach attach(profile);
+        bool ok = true;
+        try {
+            PROFILE_SCOPE("write");
+            if (obj) {
+                files.push_back(base + ".obj" + zext);
+                mesh->writeOBJ(files.back());
+            }
+            if (ply && !bundle) {
+                files.push_back(base + ".ply" + zext);
+                mesh->writePLY(files.back());
+            }
+            if (off) {
+                files.push_back(base + ".off" + zext);
+                mesh->writeOFF(files.back());
+            }
+
+            // Write fields
+            if (bundle) {
+                // Mesh and all fields in a single file (UVs are mesh
+                // properties)
+                FieldBundle fb(mesh);
+                if (signal) fb.add("scalar", signal);
+                if (laplacian) fb.add("laplacian", laplacian);
+                if (gradient) fb.add("gradient", gradient);
+                if (hessian) fb.add("hessian", hessian);
+                if (faceGradient) fb.add("face_gradient", faceGradient);
+                files.push_back(base + ".ply" + zext);
+                fb.write(files.back(), bundleFormat);
+            }
+            else {
+                const std::string txt = ".txt" + zext;
+                if (signal) {
+                    files.push_back(base + "Scalar" + txt);
+                    signal->write(files.back(), head);
                 }
-                if (hes) {
-                    hessian->write(
-                        cm["outFolder"] + mesh->name + "Hessian.txt",
-                        head
-                    );
-                    delete hessian;
+                if (laplacian) {
+                    files.push_back(base + "Laplacian" + txt);
+                    laplacian->write(files.back(), head);
                 }
-                if (euv) {
-                    uvfield->write2d(cm["outFolder"] + mesh->name + "UV.txt");
-                    delete uvfield;
+                if (gradient) {
+                    files.push_back(base + "Gradient" + txt);
+                    gradient->write(files.back(), head);
                 }
-            }
-
-            // Face diff. quantities
-            if (cm["scalarFaceGradient"] == "true") {
-                const uint fn = mesh->faceNum();
-                VectorField faceGradient(mesh, true);
-                for (uint i = 0; i < fn; ++i) {
-                    uint f[3] = {
-                        mesh->cFacei(i, 0),
-                        mesh->cFacei(i, 1),
-                        mesh->cFacei(i, 2)
-                    };
-                    glm::dvec2 centroidUV(0);
-                    for (uint ti = 0; ti < 3; ++ti) {
-                        const glm::dvec2 uv(
-                            mesh->cAttrib(f[ti], Mesh::Attribute::U),
-                            mesh->cAttrib(f[ti], Mesh::Attribute::V)
-                        );
-                        centroidUV += uv;
-                    }
-                    centroidUV /= glm::dvec1(3);
-                    double ff, ffu, ffv, ffuu, ffuv, ffvv;
-		            signal.evaluate(centroidUV.x, centroidUV.y,
-                        ff, ffu, ffv, ffuu, ffuv, ffvv);
-                    faceGradient.setValue(
-                        mesh->gradient(centroidUV.x, centroidUV.y,
-                            ff, ffu, ffv), i);
+                if (hessian) {
+                    files.push_back(base + "Hessian" + txt);
+                    hessian->write(files.back(), head);
+                }
+                if (uvfield) {
+                    files.push_back(base + "UV" + txt);
+                    uvfield->write2d(files.back());
+                }
+                if (faceGradient) {
+                    files.push_back(base + "FaceGradient" + txt);
+                    faceGradient->write(files.back(), head);
                 }
-                const bool head = (cm["scalarHeader"] == "true");
-                faceGradient.write(cm["outFolder"]
-                    + mesh->name + "FaceGradient.txt", head);
             }
         }
+        catch (Mesh::FileOpenException e) {
+            std::cerr << e.what() << " (conf:" << cname << ')' <<
+                std::endl;
+            ok = false;
+        }
+        catch (Mesh::FileWriteException e) {
+            std::cerr << e.what() << " (conf:" << cname << ')' <<
+                std::endl;
+            ok = false;
+        }
+        record(entry, ok && written, files);
+
+        // Destroy
+        delete signal;
+        delete laplacian;
+        delete gradient;
+        delete hessian;
+        delete uvfield;
+        delete faceGradient;
         delete mesh;
+        profile->write(profilePath);
+        delete profile;
+    };
+
+    // Meshes shown in the viewer own GL buffers, so they are written
+    // and destroyed on this thread
+    if (mesh->hasGLBuffers()) output();
+    else {
+        size_t bytes = mesh->byteSize();
+        if (signal) bytes += signal->byteSize();
+        if (laplacian) bytes += laplacian->byteSize();
+        if (gradient) bytes += gradient->byteSize();
+        if (hessian) bytes += hessian->byteSize();
+        if (uvfield) bytes += uvfield->byteSize();
+        if (faceGradient) bytes += faceGradient->byteSize();
+        writer.submit(output, bytes);
     }
 }
\ No newline at end of file
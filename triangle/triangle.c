@@ -640,17 +640,19 @@ struct memorypool {
 
 
 /* Global constants.                                                         */
+/* (nicemesh: per thread, so that threads can triangulate separate point    */
+/*   sets at the same time.)                                                 */
 
-REAL splitter;       /* Used to split REAL factors for exact multiplication. */
-REAL epsilon;                             /* Floating-point machine epsilon. */
-REAL resulterrbound;
-REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
-REAL iccerrboundA, iccerrboundB, iccerrboundC;
-REAL o3derrboundA, o3derrboundB, o3derrboundC;
+__thread REAL splitter; /* Used to split REAL factors for exact multiplication. */
+__thread REAL epsilon;                    /* Floating-point machine epsilon. */
+__thread REAL resulterrbound;
+__thread REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
+__thread REAL iccerrboundA, iccerrboundB, iccerrboundC;
+__thread REAL o3derrboundA, o3derrboundB, o3derrboundC;
 
 /* Random number seed is not constant, but I've made it global anyway.       */
 
-unsigned long randomseed;                     /* Current random number seed. */
+__thread unsigned long randomseed;            /* Current random number seed. */
 
 
 /* Mesh data structure.  Triangle operates on only one mesh, but the mesh    */